@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "storage_mgr.h"
+#include "checksum.h"
+
+/*
+ * Measures what page checksums cost: raw CRC32C throughput of the hardware and portable
+ * versions, then readBlock over the same file contents with and without checksums.
+ * Usage: bench_checksum [numPages [pageSize]], the defaults read 64MB of 4KB pages.
+ */
+#define BENCH_ROUNDS 3  // best of, the first round also warms the OS page cache
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static double gbPerSec (double bytes, double seconds)
+{
+	return bytes / seconds / 1e9;
+}
+
+
+// Best time to compute the CRC of every page in buf
+static double timeCrc (uint32_t (*crc) (uint32_t, const void *, size_t), const char *buf, int numPages, int pageSize)
+{
+	double best = 1e9;
+	volatile uint32_t sink = 0;
+	int round, i;
+	for (round = 0; round < BENCH_ROUNDS; round++)
+	{
+		double start = now();
+		for (i = 0; i < numPages; i++)
+			sink ^= crc(0, buf + (size_t) i * pageSize, pageSize - PAGE_CHECKSUM_SIZE);
+		double t = now() - start;
+		if (t < best)
+			best = t;
+	}
+	return best;
+}
+
+
+// Write numPages pages with some content and return the best time to read them all back with readBlock
+static double timeReads (char *fileName, int numPages, int pageSize, int options)
+{
+	SM_FileHandle fh;
+	SM_PageHandle ph = (SM_PageHandle) malloc(pageSize);
+	double best = 1e9;
+	int round, i;
+
+	createPageFileWithOptions(fileName, pageSize, options);
+	openPageFile(fileName, &fh);
+	ensureCapacity(numPages, &fh);
+	for (i = 0; i < numPages; i++)
+	{
+		memset(ph, 'a' + i % 26, pageSize);
+		writeBlock(i, &fh, ph);
+	}
+
+	for (round = 0; round < BENCH_ROUNDS; round++)
+	{
+		double start = now();
+		for (i = 0; i < numPages; i++)
+		{
+			if (readBlock(i, &fh, ph) != RC_OK)
+			{
+				printf("page %d failed its checksum\n", i);
+				exit(1);
+			}
+		}
+		double t = now() - start;
+		if (t < best)
+			best = t;
+	}
+	closePageFile(&fh);
+	destroyPageFile(fileName);
+	free(ph);
+	return best;
+}
+
+
+int main (int argc, char *argv[])
+{
+	int numPages = (argc > 1) ? atoi(argv[1]) : 16384;
+	int pageSize = (argc > 2) ? atoi(argv[2]) : PAGE_SIZE;
+	double bytes = (double) numPages * pageSize;
+	char *buf = (char *) malloc((size_t) numPages * pageSize);
+	int i;
+
+	for (i = 0; i < numPages * pageSize; i++)
+		buf[i] = (char) (i * 31 + (i >> 12));
+
+	double hw = timeCrc(crc32c, buf, numPages, pageSize);
+	double sw = timeCrc(crc32cPortable, buf, numPages, pageSize);
+	printf("CRC32C %s: %.2f GB/s, portable: %.2f GB/s\n", crc32cIsHardware() ? "hardware" : "(no hardware support)",
+			gbPerSec(bytes, hw), gbPerSec(bytes, sw));
+	free(buf);
+
+	double plain = timeReads("bench_checksum.bin", numPages, pageSize, 0);
+	double checked = timeReads("bench_checksum.bin", numPages, pageSize, SM_PAGE_CHECKSUMS);
+	printf("readBlock of %d pages of %d bytes: %.2f GB/s plain, %.2f GB/s verified\n", numPages, pageSize,
+			gbPerSec(bytes, plain), gbPerSec(bytes, checked));
+	printf("verification overhead: %.1f%% of read time, %.3f ms per GB read\n",
+			100.0 * (checked - plain) / plain, (checked - plain) * 1e3 / (bytes / 1e9));
+	return 0;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/*
+ * Measures reads of one hot page from several threads at once: pinPage/unpinPage,
+ * a shared latch on top of the pin, and optimistic reads that take neither. Each read
+ * copies the first bytes of the page. Usage: bench_latch [maxThreads [readsPerThread]],
+ * the defaults double the threads up to 8 and read 1M times per thread.
+ */
+#define BENCH_FILE "bench_latch.bin"
+#define READ_BYTES 64  // about one B-tree inner node search
+
+enum { MODE_PIN, MODE_LATCH, MODE_OPTIMISTIC };
+
+typedef struct BenchJob
+{
+	BM_BufferPool *bm;
+	int mode;
+	long reads;
+	long restarts;  // optimistic reads that failed their validation
+} BenchJob;
+
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void *reader (void *arg)
+{
+	BenchJob *job = (BenchJob *) arg;
+	BM_PageHandle h;
+	BM_OptimisticRead r;
+	char copy[READ_BYTES];
+	long i;
+
+	if (job->mode == MODE_OPTIMISTIC)
+		lookupPageOptimistic(job->bm, 0, &r);
+	for (i = 0; i < job->reads; i++)
+	{
+		switch (job->mode)
+		{
+			case MODE_PIN:
+				pinPage(job->bm, &h, 0);
+				memcpy(copy, h.data, READ_BYTES);
+				unpinPage(job->bm, &h);
+				break;
+			case MODE_LATCH:
+				pinPageLatched(job->bm, &h, 0, BM_LATCH_SHARED);
+				memcpy(copy, h.data, READ_BYTES);
+				unpinPageLatched(job->bm, &h, BM_LATCH_SHARED);
+				break;
+			default:
+				while (beginOptimisticRead(&r) != RC_OK || (memcpy(copy, r.data, READ_BYTES), !validateOptimisticRead(&r)))
+					job->restarts += 1;
+		}
+		__asm__ volatile ("" : : "r" (copy) : "memory");  // keep the copy
+	}
+	return NULL;
+}
+
+
+// Millions of reads per second with numThreads threads reading in mode
+static double run (BM_BufferPool *bm, int mode, int numThreads, long reads)
+{
+	pthread_t threads[numThreads];
+	BenchJob jobs[numThreads];
+	int i;
+	double start = now();
+	for (i = 0; i < numThreads; i++)
+	{
+		jobs[i].bm = bm;
+		jobs[i].mode = mode;
+		jobs[i].reads = reads;
+		jobs[i].restarts = 0;
+		pthread_create(&threads[i], NULL, reader, &jobs[i]);
+	}
+	for (i = 0; i < numThreads; i++)
+		pthread_join(threads[i], NULL);
+	return numThreads * reads / (now() - start) / 1e6;
+}
+
+
+int main (int argc, char *argv[])
+{
+	int maxThreads = (argc > 1) ? atoi(argv[1]) : 8;
+	long reads = (argc > 2) ? atol(argv[2]) : 1000000;
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	int n;
+
+	createPageFile(BENCH_FILE);
+	initBufferPool(&bm, BENCH_FILE, 4, RS_LRU, NULL);
+	pinPage(&bm, &h, 0);  // resident for the whole run
+	unpinPage(&bm, &h);
+
+	printf("threads    pin/unpin   shared latch   optimistic  (Mreads/s)\n");
+	for (n = 1; n <= maxThreads; n *= 2)
+		printf("%7d %12.2f %14.2f %12.2f\n", n, run(&bm, MODE_PIN, n, reads), run(&bm, MODE_LATCH, n, reads),
+				run(&bm, MODE_OPTIMISTIC, n, reads));
+
+	shutdownBufferPool(&bm);
+	destroyPageFile(BENCH_FILE);
+	return 0;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_pool.hpp"
+
+/*
+ * Compares the hit path of the C pool (pinPage/unpinPage) with the template pool of
+ * buffer_pool.hpp, for LRU, FIFO and Clock: every pin finds its page resident. Before
+ * timing, both pools read what the other wrote, with evictions, so the numbers are for
+ * pools that agree. Usage: bench_pool [numFrames [pinsPerRun]], the defaults pin 200K
+ * times over 1024 resident pages.
+ */
+#define BENCH_FILE "bench_pool.bin"
+#define BENCH_ROUNDS 3  // best of
+
+using namespace bufmgr;
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// The page numbers to pin, spread over the resident pages so each hit looks up another one
+static PageNumber *hitSequence (int numFrames, long pins)
+{
+	PageNumber *pages = (PageNumber *) malloc(sizeof(PageNumber) * pins);
+	unsigned int seed = 42;
+	long i;
+	for (i = 0; i < pins; i++)
+		pages[i] = rand_r(&seed) % numFrames;
+	return pages;
+}
+
+
+static void fail (const char *what)
+{
+	printf("pools disagree: %s\n", what);
+	exit(1);
+}
+
+
+// Pages written through the template pool and evicted come back through the C pool, and the other way round
+template <class Policy>
+static void crossCheck (int numFrames)
+{
+	int numPages = 2 * numFrames;
+	BufferPool<Policy> pool;
+	typename BufferPool<Policy>::PinGuard page;
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	int i;
+
+	createPageFile((char *) BENCH_FILE);
+	if (pool.open(BENCH_FILE, numFrames) != RC_OK)
+		fail("open");
+	for (i = 0; i < numPages; i++)
+	{
+		if (pool.pin(i, page) != RC_OK)
+			fail("pin in the template pool");
+		sprintf(page.data(), "page %d from C++", i);
+		page.markDirty();
+	}
+	page.release();
+	if (pool.close() != RC_OK || pool.getNumWriteIO() != numPages)
+		fail("write-back of the template pool");
+
+	initBufferPool(&bm, (char *) BENCH_FILE, numFrames, RS_LRU, NULL);
+	for (i = 0; i < numPages; i++)
+	{
+		char expected[64];
+		sprintf(expected, "page %d from C++", i);
+		pinPage(&bm, &h, i);
+		if (strcmp(h.data, expected) != 0)
+			fail("C pool reading the template pool's pages");
+		sprintf(h.data, "page %d from C", i);
+		markDirty(&bm, &h);
+		unpinPage(&bm, &h);
+	}
+	shutdownBufferPool(&bm);
+
+	pool.open(BENCH_FILE, numFrames);
+	for (i = numPages - 1; i >= 0; i--)
+	{
+		char expected[64];
+		sprintf(expected, "page %d from C", i);
+		if (pool.pin(i, page) != RC_OK || strcmp(page.data(), expected) != 0)
+			fail("template pool reading the C pool's pages");
+	}
+	page.release();
+	pool.close();
+	destroyPageFile((char *) BENCH_FILE);
+}
+
+
+// Best nanoseconds per pin and unpin of the C pool
+static double timeC (ReplacementStrategy strategy, int numFrames, const PageNumber *pages, long pins)
+{
+	BM_BufferPool bm;
+	BM_PageHandle h;
+	double best = 1e9;
+	long i;
+	int round;
+
+	createPageFile((char *) BENCH_FILE);
+	initBufferPool(&bm, (char *) BENCH_FILE, numFrames, strategy, NULL);
+	for (i = 0; i < numFrames; i++)  // resident for the whole run
+	{
+		pinPage(&bm, &h, i);
+		unpinPage(&bm, &h);
+	}
+	int reads = getNumReadIO(&bm);
+	for (round = 0; round < BENCH_ROUNDS; round++)
+	{
+		double start = now();
+		for (i = 0; i < pins; i++)
+		{
+			pinPage(&bm, &h, pages[i]);
+			__asm__ volatile ("" : : "r" (h.data) : "memory");
+			unpinPage(&bm, &h);
+		}
+		double t = now() - start;
+		if (t < best)
+			best = t;
+	}
+	if (getNumReadIO(&bm) != reads)
+		fail("C pool missed during the run");
+	shutdownBufferPool(&bm);
+	destroyPageFile((char *) BENCH_FILE);
+	return best * 1e9 / pins;
+}
+
+
+// The same for the template pool, the guard unpins as each iteration ends
+template <class Policy>
+static double timeTemplate (int numFrames, const PageNumber *pages, long pins)
+{
+	BufferPool<Policy> pool;
+	double best = 1e9;
+	long i;
+	int round;
+
+	createPageFile((char *) BENCH_FILE);
+	pool.open(BENCH_FILE, numFrames);
+	for (i = 0; i < numFrames; i++)
+	{
+		typename BufferPool<Policy>::PinGuard page;
+		pool.pin(i, page);
+	}
+	int reads = pool.getNumReadIO();
+	for (round = 0; round < BENCH_ROUNDS; round++)
+	{
+		double start = now();
+		for (i = 0; i < pins; i++)
+		{
+			typename BufferPool<Policy>::PinGuard page;
+			pool.pin(pages[i], page);
+			__asm__ volatile ("" : : "r" (page.data()) : "memory");
+		}
+		double t = now() - start;
+		if (t < best)
+			best = t;
+	}
+	if (pool.getNumReadIO() != reads)
+		fail("template pool missed during the run");
+	pool.close();
+	destroyPageFile((char *) BENCH_FILE);
+	return best * 1e9 / pins;
+}
+
+
+int main (int argc, char *argv[])
+{
+	int numFrames = (argc > 1) ? atoi(argv[1]) : 1024;
+	long pins = (argc > 2) ? atol(argv[2]) : 200000;
+	PageNumber *pages = hitSequence(numFrames, pins);
+
+	crossCheck<LruPolicy>(16);
+	crossCheck<FifoPolicy>(16);
+	crossCheck<ClockPolicy>(16);
+
+	printf("%d resident pages, ns per pin+unpin hit\n", numFrames);
+	printf("policy          C API     template\n");
+	printf("LRU      %12.1f %12.1f\n", timeC(RS_LRU, numFrames, pages, pins), timeTemplate<LruPolicy>(numFrames, pages, pins));
+	printf("FIFO     %12.1f %12.1f\n", timeC(RS_FIFO, numFrames, pages, pins), timeTemplate<FifoPolicy>(numFrames, pages, pins));
+	printf("Clock    %12.1f %12.1f\n", timeC(RS_CLOCK, numFrames, pages, pins), timeTemplate<ClockPolicy>(numFrames, pages, pins));
+	free(pages);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "storage_mgr.h"
+
+/*
+ * Measures how fast a page file can be read front to back: readBlock page by page,
+ * readBlocks in chunks and a scan cursor, which reads the next chunk while the current
+ * one is used. Usage: bench_scan [numPages [chunkPages]], the defaults read 256MB of 4KB
+ * pages in chunks of SM_DEFAULT_SCAN_CHUNK_PAGES. Run it on a cold cache (echo 3 >
+ * /proc/sys/vm/drop_caches between runs) to compare against the device bandwidth.
+ */
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Something that uses every page, so the scans can't skip the copies
+static unsigned long touch (const char *page, int pageSize)
+{
+	unsigned long sum = 0;
+	int i;
+	for (i = 0; i < pageSize; i += 64)
+		sum += (unsigned char) page[i];
+	return sum;
+}
+
+
+int main (int argc, char *argv[])
+{
+	int numPages = (argc > 1) ? atoi(argv[1]) : 65536;
+	int chunkPages = (argc > 2) ? atoi(argv[2]) : SM_DEFAULT_SCAN_CHUNK_PAGES;
+	char *fileName = "bench_scan.bin";
+	SM_FileHandle fh;
+	SM_ScanCursor cursor;
+	SM_PageHandle page;
+	unsigned long sum = 0;
+	int i, j;
+
+	createPageFile(fileName);
+	openPageFile(fileName, &fh);
+	SM_PageHandle *chunk = (SM_PageHandle *) malloc(sizeof(SM_PageHandle) * chunkPages);
+	for (j = 0; j < chunkPages; j++)
+		chunk[j] = (SM_PageHandle) malloc(fh.pageSize);
+	for (i = 0; i < numPages; i += chunkPages)  // fill the file with writeBlocks
+	{
+		int count = (numPages - i < chunkPages) ? numPages - i : chunkPages;
+		for (j = 0; j < count; j++)
+			memset(chunk[j], 'a' + (i + j) % 26, fh.pageSize);
+		writeBlocks(i, count, &fh, chunk);
+	}
+	double mb = (double) numPages * fh.pageSize / 1e6;
+
+	double start = now();
+	for (i = 0; i < numPages; i++)
+	{
+		readBlock(i, &fh, chunk[0]);
+		sum += touch(chunk[0], fh.pageSize);
+	}
+	double single = now() - start;
+
+	start = now();
+	for (i = 0; i < numPages; i += chunkPages)
+	{
+		int count = (numPages - i < chunkPages) ? numPages - i : chunkPages;
+		readBlocks(i, count, &fh, chunk);
+		for (j = 0; j < count; j++)
+			sum += touch(chunk[j], fh.pageSize);
+	}
+	double vectored = now() - start;
+
+	start = now();
+	openScanCursor(&fh, 0, numPages, chunkPages, &cursor);
+	while (scanNextBlock(&cursor, &page) == RC_OK)
+		sum += touch(page, fh.pageSize);
+	closeScanCursor(&cursor);
+	double streamed = now() - start;
+
+	printf("%d pages of %d bytes, chunks of %d pages (checksum %lu)\n", numPages, fh.pageSize, chunkPages, sum);
+	printf("readBlock: %.0f MB/s, readBlocks: %.0f MB/s, scan cursor: %.0f MB/s\n", mb / single, mb / vectored, mb / streamed);
+	for (j = 0; j < chunkPages; j++)
+		free(chunk[j]);
+	free(chunk);
+	closePageFile(&fh);
+	destroyPageFile(fileName);
+	return 0;
+}
@@ -1,551 +1,3664 @@
-#include<stdio.h>
-#include<stdlib.h>
-#include "buffer_mgr.h"
-#include "storage_mgr.h"
-#include <math.h>
-#include "test_helper.h"
-
-
-//prototypes for replacement strategies
-extern void LRU(BM_BufferPool *const bm, BM_PageHandle *page);
-extern void Clock(BM_BufferPool *const bm, BM_PageHandle *page);
-extern void FIFO(BM_BufferPool *const bm, BM_PageHandle *page);
-extern void LFU(BM_BufferPool *const bm, BM_PageHandle *page);
-extern void displaycontents(BM_BufferPool *const bm);  // Helper function to display each frame's detail
-
-
-// Define a pageframe using struct
-struct Frame 
-{
-    BM_PageHandle page;  // contains page content and position of the page inside pagefile
-    bool is_Dirty;
-    bool is_pinned;
-    int fixCount;
-    int readCount;
-    int writeCount;
-    int score; // used by LRU and LFU
-    int ref_bit; // used by clock
-};
-typedef struct Frame PageFrames;
-
-
-// Global variable
-int Frameptr = 0; // Frameptr will point to 0th frame initially -- Used by FIFO and Clock
-
-
-// Function definitions
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData)
-{
-    PageFrames *pool = (PageFrames *)malloc(sizeof(PageFrames) * numPages); // Initialize bufferpool in memory
-    bm->pageFile = (char *const)pageFileName;
-    bm->numPages = numPages;
-    bm->strategy = strategy;
-
-    int i;
-    for (i = 0; i < numPages; i++)
-    {
-        pool[i].is_Dirty = false;
-        pool[i].is_pinned = false;
-        pool[i].fixCount = 0;
-        pool[i].page.pageNum = NO_PAGE; // store NO_PAGE (-1) initially
-        pool[i].page.data = NULL;
-        pool[i].readCount = 0;
-        pool[i].writeCount = 0;
-        pool[i].score = 0;
-        pool[i].ref_bit = 0;
-    }
-
-    bm->mgmtData = (PageFrames *)pool; // Store memory pointer to pool in mgmtData
-    printf("buffer manager has been initialized\n");
-    
-    return RC_OK;
-}
-
-
-RC shutdownBufferPool(BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int i;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].is_pinned == true)
-            return RC_BUFFER_IN_USE_BY_CLIENT; // return error if page is in use by a client
-
-        if (pool[i].is_Dirty == true)
-            forcePage(bm, &pool[i].page); // call forcepage to write back, if the page is dirty
-    }
-    free(pool); // free memory after everything is written on disk
-    return RC_OK;
-}
-
-
-RC forceFlushPool(BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    SM_FileHandle fh;
-    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
-    openPageFile (bm->pageFile, &fh);
-    int i;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].is_pinned == true || pool[i].fixCount > 0)
-            return RC_BUFFER_IN_USE_BY_CLIENT;
-
-        else if (pool[i].is_Dirty == true)
-        {
-            ph = pool[i].page.data;
-            writeBlock (pool[i].page.pageNum, &fh, ph);
-            readPreviousBlock(&fh, ph);
-            pool[i].is_Dirty = false;
-            pool[i].writeCount += 1;
-        }
-    }
-    return RC_OK;
-}
-
-
-RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int i;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].page.pageNum == page->pageNum)
-        {
-            pool[i].is_Dirty = true;
-            break;
-        }
-    }
-    return RC_OK;
-}
-
-
-RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int i;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].page.pageNum == page->pageNum)
-        {
-            pool[i].fixCount -= 1;
-            if (pool[i].fixCount == 0)
-                pool[i].is_pinned = false;
-            break;
-        }
-    }
-    return RC_OK;
-}
-
-
-RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    SM_FileHandle fh;
-    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
-    openPageFile (bm->pageFile, &fh);
-    int i;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].page.pageNum == page->pageNum)
-        {
-            if (pool[i].is_Dirty == false) 
-                return RC_PAGE_WAS_NOT_MODIFIED;  // return error if page remained unchanged while in buffer
-            else
-            {
-                ph = pool[i].page.data;
-                writeBlock(pool[i].page.pageNum, &fh, ph);
-                pool[i].is_Dirty = false;
-                pool[i].writeCount += 1;
-                break;
-            }
-        }
-    }
-    return RC_OK;
-}
-
-
-RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    // Check if buffer manager already has the requested page
-    int i, index;
-    bool pageFound = false;
-    bool spaceFound = false;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].page.pageNum == pageNum) // Found requested page in buffer pool
-        {
-            index = i;
-            pool[i].fixCount += 1;  // increase fixCount of that frame
-            pool[i].is_pinned = true;
-            pageFound = true;
-            break;
-        }
-    }
-    
-    if (!pageFound) // If page not found in the pool, check for empty frame
-    {
-        //Check for the space in bufferpool
-        for (i = 0; i < bm->numPages; i++)
-        {
-            if (pool[i].page.pageNum == NO_PAGE) // Found empty frame
-            {
-                SM_FileHandle fh;  
-                SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
-                openPageFile (bm->pageFile, &fh);
-                
-                if (pageNum >= fh.totalNumPages)
-                {
-                    appendEmptyBlock(&fh);
-                }
-                    
-                readBlock(pageNum, &fh, ph);  // read page from disk into the frame
-                pool[i].page.data = ph;
-                pool[i].page.pageNum = pageNum;
-                pool[i].readCount += 1; // increase readCount
-                pool[i].fixCount += 1;
-                pool[i].is_pinned = true;
-                pool[i].ref_bit = 1; // Set reference bit to 1 (used by clock alg)
-                index = i; // Store index of frame
-                spaceFound = true;
-                break;
-            }
-        }
-    }
-    
-    if (pageFound && !spaceFound) // Update scores and reference bit of frames
-    {
-        if (bm->strategy == RS_LRU)
-        {
-            for (i = 0; i < bm->numPages; i++)
-            {
-                if (pool[i].score >= pool[index].score) // Decrease score of frames which had greater scores
-                    pool[i].score -= 1;
-            }
-            pool[index].score = bm->numPages - 1; // Assign current pageframe highest LRU score
-        }
-        else if (bm->strategy == RS_CLOCK)
-        {
-            pool[index].ref_bit = 1; // Set reference bit to 1 (for Clock)
-            Frameptr += 1; // move pointer to next frame
-            if (Frameptr >= bm->numPages)
-                Frameptr = 0;
-        }
-        else if (bm->strategy == RS_LFU)
-            pool[index].score += 1; // Increase the score if requested page was a hit
-    }
-    else if (spaceFound && !pageFound) // decrement scores of existing pages in the frame
-    {
-        if (bm->strategy == RS_LRU)
-        {
-            for (i = 0; i < bm->numPages; i++)
-            {
-                if (pool[i].page.pageNum != NO_PAGE) // Decrease score of all frames in which data exists
-                    pool[i].score -= 1;
-            }
-            pool[index].score = bm->numPages - 1; // Assign pageframe highest LRU score
-        }
-        else if (bm->strategy == RS_CLOCK || bm->strategy == RS_FIFO)
-            Frameptr = index;  // Set Frame pointer to this frame
-            
-        else if (bm->strategy == RS_LFU)
-        {
-            pool[index].score = 1; // Set score for 
-            Frameptr = index;  // Set Frame pointer to this frame
-        }
-    }
-    else if (!spaceFound && !pageFound) // If requested page is not in buffer and there is no space in the pool, replace an existing page using a strategy
-    {
-        SM_FileHandle fh;  
-        SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
-        openPageFile (bm->pageFile, &fh);
-        if (pageNum >= fh.totalNumPages)
-        {
-            appendEmptyBlock(&fh);
-        }
-        readBlock(pageNum, &fh, ph);  // read page from disk into the tempframe
-        page->data = ph;
-        page->pageNum = pageNum;
-        switch(bm->strategy) // 
-        {			
-            case RS_LRU: // Using LRU algorithm
-                LRU(bm, page);
-                return RC_OK;
-            
-            case RS_CLOCK:
-                Clock(bm, page);
-                return RC_OK;
-
-            case RS_FIFO:
-                FIFO(bm, page);
-                return RC_OK;
-
-            case RS_LFU:
-                LFU(bm, page);
-                return RC_OK;
-
-            default:
-                printf("\nAlgorithm Not Implemented\n");
-                break;
-        }
-    }
-
-    //Store the information into page which is used by the client
-    
-    page->pageNum = pageNum;
-    page->data = pool[index].page.data;
-    return RC_OK;
-}
-
-
-PageNumber *getFrameContents (BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    PageNumber *PageNumbers = (PageNumber *)malloc(sizeof(bm->numPages)); // declare a PageNumber type array of size = number of frames in bufferpool
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        PageNumbers[i] = pool[i].page.pageNum;
-    }
-    return PageNumbers;
-}
-
-
-bool *getDirtyFlags (BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    bool *DirtyFlags = (bool *)malloc(sizeof(bm->numPages)); // declare a boolean array of size = number of frames in buffer
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        DirtyFlags[i] = pool[i].is_Dirty;
-    }
-    
-    return DirtyFlags;
-}
-
-
-int *getFixCounts (BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int *FixCounts = (int *)malloc(sizeof(bm->numPages)); // declare a integer array of size = number of frames in buffer
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        FixCounts[i] = pool[i].fixCount;
-    }
-
-    return FixCounts;
-}
-
-
-int getNumReadIO (BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int NumReadIO = 0;
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        NumReadIO += pool[i].readCount;  // Add readCount for each frame
-    }
-
-    return NumReadIO;
-}
-
-
-int getNumWriteIO (BM_BufferPool *const bm)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int NumWriteIO = 0;
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        NumWriteIO += pool[i].writeCount;  // Add writeCount for each frame
-    }
-
-    return NumWriteIO;
-}
-
-
-extern void LRU(BM_BufferPool *const bm, BM_PageHandle *page)
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int i, index, replace_score = 0; // score of least recently used frame would be zero
-    bool spaceFound = false;
-    while (!spaceFound)
-    {
-        for (i = 0; i < bm->numPages; i++)
-        {
-            if(pool[i].score == replace_score) // Find frame with least score
-            {
-                if (pool[i].is_pinned == true || pool[i].fixCount > 0) // if page in the frame is in use
-                {
-                    replace_score += 1; // move to next least recently used frame
-                    break;
-                }
-                else
-                {
-                    spaceFound = true; // break for and while loop and store the index of this frame
-                    index = i;
-                    break;
-                }
-            }
-        }
-    }
-
-    // Check if the page was modified in this frame
-    if(pool[index].is_Dirty == true) 
-        forcePage(bm, &pool[i].page); // write page onto the disk
-
-    // Replace with new page information
-    pool[index].page.data = page->data;
-    pool[index].page.pageNum = page->pageNum;
-    pool[index].is_pinned = true;
-    pool[index].fixCount = 1;
-    pool[index].is_Dirty = false;
-    pool[index].readCount += 1;
-    for(i = 0; i < bm->numPages; i++)
-    {
-        if (pool[i].score >= pool[index].score) // Decrease score of frames which had greater scores
-            pool[i].score -= 1;
-    }
-    pool[index].score = bm->numPages - 1; // assign highest score as it will be the most recently used frame
-
-}
-
-
-extern void Clock(BM_BufferPool *const bm, BM_PageHandle *page) // Need to include checks for fixCount
-{
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    Frameptr += 1;
-
-    if (Frameptr == bm->numPages) // Set Frameptr to 0 if it moves past last frame (to move in circle)
-            Frameptr = 0;
-
-    while(1)
-    {
-        if(pool[Frameptr].ref_bit == 0) // if reference bit was 0 (frame to be replaced, found)
-        {
-            if (pool[Frameptr].is_Dirty == true) //check if the page is dirty
-                forcePage(bm, &pool[Frameptr].page); // Write page back to the disk
-
-            break; // break from while loop
-        }
-            
-        else // if reference bit was 1
-        {
-            pool[Frameptr].ref_bit = 0;
-            Frameptr += 1;
-            if (Frameptr == bm->numPages) // Set Frameptr to 0 if it reaches last frame (to move in circle)
-                Frameptr = 0;
-        }
-    }
-
-    //Write data into the frame
-    pool[Frameptr].page.data = page->data;
-    pool[Frameptr].page.pageNum = page->pageNum;
-    pool[Frameptr].is_pinned = true;
-    pool[Frameptr].is_Dirty = false;
-    pool[Frameptr].fixCount = 1;
-    pool[Frameptr].readCount += 1;
-    pool[Frameptr].ref_bit = 1;
-}
-
-/*defining function FIFO*/ 
-extern void FIFO(BM_BufferPool *const bm, BM_PageHandle *page)
-{
-    Frameptr += 1;
-    if (Frameptr >= bm->numPages)
-        Frameptr = 0;
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    bool spaceFound = false;
-    while (!spaceFound)
-    {
-        if (pool[Frameptr].is_pinned == true) // Move to next frame if page is in use
-        {
-            Frameptr += 1;
-            if (Frameptr >= bm->numPages)
-                Frameptr = 0;
-        }
-        
-        else  // Page not in use
-            spaceFound = true; // Found the Frame where page is to be replaced
-    }
-    
-    if (pool[Frameptr].is_Dirty)  //check if the page is dirty
-        forcePage(bm, &pool[Frameptr].page);  // Write page back to the disk
-
-    pool[Frameptr].page.data = page->data;
-    pool[Frameptr].page.pageNum = page->pageNum;
-    pool[Frameptr].is_pinned = true;
-    pool[Frameptr].is_Dirty = false;
-    pool[Frameptr].fixCount = 1;
-    pool[Frameptr].readCount += 1;
-    pool[Frameptr].ref_bit = 1;
-}
-
-
-
-extern void LFU(BM_BufferPool *const bm, BM_PageHandle *page)
-{
-    int replace_score = 1,index; 
-    Frameptr += 1;
-    if (Frameptr >= bm->numPages)
-        Frameptr = 0;
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    index = Frameptr;
-    while (1)
-    {
-        if (pool[Frameptr].score == replace_score) // Least frequent score
-            break; // Found the Frame where page is to be replaced
-        else  // Page not in use
-        {
-            Frameptr += 1;
-            if (Frameptr >= bm->numPages)
-                Frameptr = 0;
-        }   
-        if (Frameptr == index) // If Frameptr reaches original frame, increase replace score
-        {
-            replace_score += 1;
-            Frameptr += 1;
-            if (Frameptr >= bm->numPages)
-            Frameptr = 0;
-        }
-    }
-    
-    if (pool[Frameptr].is_Dirty)  //check if the page is dirty
-        forcePage(bm, &pool[Frameptr].page);  // Write page back to the disk
-
-    pool[Frameptr].page.data = page->data;
-    pool[Frameptr].page.pageNum = page->pageNum;
-    pool[Frameptr].is_pinned = true;
-    pool[Frameptr].is_Dirty = false;
-    pool[Frameptr].fixCount = 1;
-    pool[Frameptr].readCount += 1;
-    pool[Frameptr].score = 1;
-}
-
-extern void displaycontents(BM_BufferPool *const bm)
-{
-    printf("\n\nBufferpool's information:\n");
-    printf("Number of frames: %d\n",bm->numPages);
-    printf("Page file: %s\n",bm->pageFile);
-    printf("Strategy: %d\n",bm->strategy);
-    PageFrames *pool = (PageFrames *)bm->mgmtData;
-    int i;
-    for (i = 0; i < bm->numPages; i++)
-    {
-        printf("\nFrame: %d\n", i);
-        printf("pagenum: %d\n", pool[i].page.pageNum);
-        printf("page content: %s\n",pool[i].page.data);
-        printf("is_dirty: %d\n",pool[i].is_Dirty);
-        printf("is_pinned: %d\n",pool[i].is_pinned);
-        printf("fixCount: %d\n",pool[i].fixCount);
-        printf("readCount: %d\n",pool[i].readCount);
-        printf("writeCount: %d\n",pool[i].writeCount);
-        printf("score: %d\n",pool[i].score);
-        printf("ref_bit: %d\n",pool[i].ref_bit);
-        printf("Frame pointer value %d\n", Frameptr);
-    }
+#include<stdio.h>
+#include<stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "compressed_tier.h"
+#include "l2_cache.h"
+#include "checksum.h"
+#include <math.h>
+#include <assert.h>
+#include "test_helper.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define FRAME_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define FRAME_SCAN_NEON 1
+#endif
+
+
+//prototypes for replacement strategies
+static const BM_ReplacementPolicy *builtinPolicy(const ReplacementStrategy strategy);
+extern void displaycontents(BM_BufferPool *const bm);  // Helper function to display each frame's detail
+static int frameHotness(BM_BufferPool *const bm, const int index);
+static RC evictFrame(BM_BufferPool *const bm, const int index);
+static void renumberLRUScores(BM_BufferPool *const bm);
+static RC pinPageLocked(BM_BufferPool *const bm, BM_PageHandle *const page, const int tenantId, const int fileId, const PageNumber pageNum);
+
+
+// Shared/exclusive latch of a frame, taken by clients after the pin and without the pool lock.
+// Allocated once per frame so it stays put when resizeBufferPool moves frames around, and
+// kept until shutdown, as optimistic readers may still look at it after the frame is gone
+typedef struct FrameLatch
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;  // broadcast whenever a holder leaves
+    int readers;  // shared holders
+    bool writer;  // held exclusively
+    bool upgrading;  // a shared holder waits to become exclusive, newcomers wait behind it
+    int waitingWriters;  // new shared requests let these go first, so writers don't starve
+    unsigned long version;  // odd while held exclusively or while the frame changes pages, see beginOptimisticRead
+    PageNumber pageNum;  // page in the frame, for optimistic readers that don't take the pool lock
+    int fileId;
+    char *data;
+    struct FrameLatch *nextRetired;  // latches of frames dropped by resizeBufferPool
+} FrameLatch;
+
+// Define a pageframe using struct
+struct Frame 
+{
+    BM_PageHandle page;  // contains page content and position of the page inside pagefile
+    bool is_Dirty;
+    bool is_pinned;
+    int fixCount;
+    int writeCount;
+    int score; // used by LRU and LFU
+    int ref_bit; // used by clock
+    LSN pageLSN; // last log record that changed the page, the log must be durable up to here before the page is written
+    LSN recLSN; // log end when the page was first dirtied after its last write, redo for it starts here
+    FrameLatch *latch; // stays with the frame, not with the page
+    BM_PinHint hint; // of the latest pin
+    bool sticky; // the page is in the pool's sticky set
+    int tenant; // whose miss read the page in, its frames count against that tenant's quota
+};
+typedef struct Frame PageFrames;
+
+static void clearFrame(PageFrames *frame);
+static void discardFrame(BM_BufferPool *const bm, const int index);
+static void markAsyncReadStale(BM_BufferPool *const bm, const PageNumber pageNum);
+static void stopAsyncIO(BM_BufferPool *const bm);
+static void setFrameFree(BM_BufferPool *const bm, const int index, const bool isFree);
+static void rebuildFrameIndex(BM_BufferPool *const bm);
+static void startEvictor(BM_BufferPool *const bm);
+static void stopEvictor(BM_BufferPool *const bm);
+static RC dropFrame(BM_BufferPool *const bm, const int index);
+
+
+#define GHOST_PAGES 64  // evicted pages remembered to estimate what more frames would gain
+#define READ_AHEAD_PAGES 16  // pages read with one readBlocks once misses look like a scan
+
+#define DEFAULT_PIN_WAIT_MILLIS 1000  // how long a pin waits for an unpin when every frame is pinned
+#define FRAME_BITS (8 * (int)sizeof(unsigned long))  // frames per word of PoolInfo.freeFrames
+
+#define ASYNC_IO_THREADS 16  // reads of pinPageAsync misses the pool has on the device at once
+
+// Request of pinPageAsync waiting for its page, then for pollPinCompletions
+typedef struct AsyncWaiter
+{
+    BM_PageHandle *page;
+    BM_PinCallback callback;
+    void *ctx;
+    RC rc;
+    struct AsyncWaiter *next;
+} AsyncWaiter;
+
+// Read of a page started by pinPageAsync, every request for the page while it is in flight waits on it
+typedef struct AsyncRead
+{
+    PageNumber pageNum;
+    bool started;  // taken by an I/O thread
+    bool stale;  // the page was written while being read, it is read again
+    AsyncWaiter *waiters;  // in the order they came in
+    struct AsyncRead *next;
+} AsyncRead;
+
+// Page file whose pages the pool caches
+typedef struct PoolFile
+{
+    char *fileName;
+    SM_FileHandle fh;  // opened once, used for every read and write of the file's pages
+    int quota;  // most frames its pages may hold, 0 for no limit
+    PageNumber firstFreeMap;  // map pages before this one have no free pages left
+} PoolFile;
+
+// A tenant of the pool, see pinPageForTenant
+typedef struct PoolTenant
+{
+    int minFrames;  // frames kept for it: its pages are only replaced while it holds more
+    int maxFrames;  // most frames its pages may hold, 0 for no limit
+    int numHits;
+    int numMisses;
+} PoolTenant;
+
+// Bookkeeping of a buffer pool, stored in mgmtData
+typedef struct PoolInfo
+{
+    PageFrames *frames;  // reallocated by resizeBufferPool, only read with the lock held
+    PoolFile *files;  // files[0] is bm->pageFile, reallocated by registerPageFile
+    int numFiles;
+    bool readOnly;  // frames point straight into a read-only mapping of the page file
+    SM_MappedFile mapped;  // used by read-only pools only
+    PageNumber lastRequested;  // previous page read in, used to detect sequential scans
+    int seqRun;  // number of consecutive pages read in so far
+    int readAheadEnd;  // first page past the range already advised as WILLNEED
+    SM_PageHandle aheadData[READ_AHEAD_PAGES];  // pages from aheadStart on read ahead of a scan, NULL once taken or stale
+    PageNumber aheadStart;
+    SM_AccessAdvice advice;  // advice currently applied to the whole mapping
+    int numReadIO;  // pages read from the page file
+    bool checksums;  // the page file keeps a checksum trailer in every page
+    CT_Cache *tier;  // compressed copies of evicted clean pages, NULL if disabled
+    L2_Cache *l2;  // copies of evicted pages on a local device, NULL if disabled
+    WAL_Log *log;  // write-ahead log for page updates, NULL if not logged
+    pthread_mutex_t lock;  // recursive, guards the frames against the background checkpoint
+    WAL_DirtyPage *ckptTable;  // dirty page table taken when the checkpoint began
+    int ckptNumPages;
+    int ckptDone;  // entries of ckptTable handled so far
+    bool ckptActive;
+    LSN ckptBeginLSN;
+    LSN ckptRedoLSN;  // redo LSN of the last completed checkpoint
+    pthread_t ckptThread;
+    bool ckptThreadRunning;  // only touched by the thread that started the checkpoint
+    int ckptRate;  // pages per second written by the background checkpoint
+    bool ckptHurry;  // finish the background checkpoint without pausing between pages
+    bool warmSave;  // save the warm list at shutdown
+    pthread_mutex_t warmLock;  // guards warmStop for the timer
+    pthread_cond_t warmCond;
+    pthread_t warmTimer;  // saves the warm list every warmInterval milliseconds
+    bool warmTimerRunning;
+    bool warmStop;
+    int warmInterval;
+    pthread_t warmUpThread;  // background warm-up
+    bool warmUpRunning;
+    PageNumber preloadPage;  // page the warm-up is installing, loadPage takes preloadData for it
+    SM_PageHandle preloadData;
+    int numWarmed;  // pages installed by the warm-up
+    PageNumber ghost[GHOST_PAGES];  // ring of the pages evicted last, ghost[ghostHead - 1] is the newest
+    int ghostFile[GHOST_PAGES];  // file of each ghost page
+    int ghostHead;
+    int ghostHits[GHOST_PAGES];  // misses on a ghost, by how many evictions ago it left
+    int coldHits[GHOST_PAGES];  // hits, by how many frames were colder than the one hit
+    int retiredWrites;  // writes counted by frames dropped when the pool shrank
+    AsyncRead *asyncReads;  // queued and running reads of pinPageAsync, oldest first
+    AsyncWaiter *completions;  // finished requests, oldest first, until pollPinCompletions runs their callbacks
+    AsyncWaiter *lastCompletion;
+    int numAsyncPending;  // requests queued or waiting for a poll
+    int numAsyncMerged;  // requests that joined a read already in flight
+    pthread_cond_t asyncCond;  // signalled when a read is queued, a request completes or the threads stop
+    pthread_t asyncThreads[ASYNC_IO_THREADS];
+    int numAsyncThreads;  // started with the first pinPageAsync
+    bool asyncStop;
+    int completionFd;  // eventfd, readable while completions wait for a poll; -1 until the threads start
+    long numLatchWaits;  // latch requests that had to wait, updated atomically
+    long latchWaitMicros;  // time they waited in total
+    FrameLatch *retiredLatches;  // freed at shutdown
+    PageNumber *framePages;  // page of each frame, side by side so lookups scan them with vector compares
+    int *frameFiles;  // file of each frame's page
+    unsigned long *freeFrames;  // a bit per frame, set while it holds no page; misses take the lowest one
+    int numFree;
+    int lowWatermark;  // the evictor starts once fewer frames than this are free
+    int highWatermark;  // and stops once this many are
+    int lowWatermarkSet, highWatermarkSet;  // as given to setFreeFrameWatermarks, for a pool of watermarkFrames frames;
+    int watermarkFrames;                    // resizes scale them from there, so repeated resizes don't round them away
+    pthread_cond_t evictCond;  // wakes the evictor, waits with the lock
+    pthread_t evictor;
+    bool evictorRunning;
+    bool evictStop;
+    int numBackgroundEvictions;  // pages evicted by the evictor
+    int pinWaitMillis;  // a miss waits this long for an unpin when every frame is pinned
+    pthread_cond_t unpinCond;  // broadcast when a frame's fixCount drops to 0 while pins wait
+    int numPinWaiters;
+    int numPinWaits;  // pins that had to wait for a frame
+    long pinWaitMicros;  // time they waited in total
+    int numPinTimeouts;  // pins that gave up with RC_ALL_FRAMES_PINNED
+    const BM_ReplacementPolicy *policy;  // stratData if given, else the built-in policy of the strategy
+    int frameptr;  // frame the built-in FIFO, Clock and LFU scans go on from, this pool's own
+    int cleanFirstMaxPercent;  // clean-first window as a share of the frames, 0 when off
+    int cleanFirstPercent;  // the window in use, smaller while writes cost little more than reads
+    bool cleanFirstAdaptive;
+    double readMicros;  // moving averages of readBlock and writeBlock, negative until measured
+    double writeMicros;
+    int numCleanFirstEvictions;  // clean pages evicted in place of a colder dirty one
+    bool hintsUsed;  // a pin gave a hint or a page was made sticky, victims are checked against them from then on
+    int stickyPercent;  // share of the frames the sticky set may take
+    PageNumber *stickyPages;  // the sticky set, pages may be in it before they are resident
+    int *stickyFiles;
+    int numSticky;
+    int stickyCapacity;
+    PoolTenant tenants[MAX_TENANTS];
+    bool tenantQuotas;  // a tenant has a quota, victims are checked against them from then on
+} PoolInfo;
+
+#define DEFAULT_STICKY_PERCENT 10
+#define IO_LATENCY_WEIGHT 8  // a new sample counts 1/8 in the moving averages
+
+#define SEQ_RUN_THRESHOLD 4  // consecutive reads after which a scan is assumed
+
+// Resident pages are saved to the page file name plus WARM_LIST_SUFFIX and preloaded from there
+#define WARM_LIST_SUFFIX ".warm"
+#define WARM_LIST_MAGIC 0x31574750  // "PGW1"
+#define WARM_BATCH_PAGES 16  // neighbouring pages read by one reader in one go
+#define WARM_THREADS 4
+
+
+// Page buffers come from arenas shared by all pools, one per page size, so pools
+// with different page sizes can live side by side without fragmenting the heap
+#define ARENA_CHUNK_PAGES 16  // buffers carved out of one allocation
+#define NUM_ARENAS 5  // one per power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE
+
+typedef struct PageArena
+{
+    void *freeList;  // free page buffers, linked through their first bytes
+    int numFree;
+} PageArena;
+
+static PageArena arenas[NUM_ARENAS];
+static pthread_mutex_t arenaLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static PageArena *arenaFor(const int pageSize)
+{
+    int i = 0;
+    while ((MIN_PAGE_SIZE << i) < pageSize)
+        i++;
+    return &arenas[i];
+}
+
+
+static char *allocPageBuffer(const int pageSize)
+{
+    PageArena *arena = arenaFor(pageSize);
+    char *data;
+    pthread_mutex_lock(&arenaLock);
+    if (arena->freeList == NULL) // arena ran dry, carve a new chunk into buffers
+    {
+        char *chunk;
+        int i;
+        if (posix_memalign((void **)&chunk, MIN_PAGE_SIZE, (size_t)pageSize * ARENA_CHUNK_PAGES) != 0)
+        {
+            pthread_mutex_unlock(&arenaLock);
+            return NULL;
+        }
+        for (i = 0; i < ARENA_CHUNK_PAGES; i++)
+        {
+            *(void **)(chunk + (size_t)i * pageSize) = arena->freeList;
+            arena->freeList = chunk + (size_t)i * pageSize;
+        }
+        arena->numFree += ARENA_CHUNK_PAGES;
+    }
+    data = arena->freeList;
+    arena->freeList = *(void **)data;
+    arena->numFree -= 1;
+    pthread_mutex_unlock(&arenaLock);
+    return data;
+}
+
+
+static void releasePageBuffer(const int pageSize, char *data)
+{
+    PageArena *arena = arenaFor(pageSize);
+    pthread_mutex_lock(&arenaLock);
+    *(void **)data = arena->freeList;
+    arena->freeList = data;
+    arena->numFree += 1;
+    pthread_mutex_unlock(&arenaLock);
+}
+
+
+// Forget the read-ahead copy of a page of the pool's own file, after the page file changed under it
+static void dropReadAheadPage(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int k = pageNum - info->aheadStart;
+    if (info->aheadStart != NO_PAGE && k >= 0 && k < READ_AHEAD_PAGES && info->aheadData[k] != NULL)
+    {
+        releasePageBuffer(bm->pageSize, info->aheadData[k]);
+        info->aheadData[k] = NULL;
+    }
+}
+
+
+static void dropReadAhead(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int k;
+    for (k = 0; k < READ_AHEAD_PAGES && info->aheadStart != NO_PAGE; k++)
+        dropReadAheadPage(bm, info->aheadStart + k);
+    info->aheadStart = NO_PAGE;
+}
+
+
+static FrameLatch *createLatch(void)
+{
+    FrameLatch *latch = (FrameLatch *)calloc(1, sizeof(FrameLatch));
+    pthread_mutex_init(&latch->mutex, NULL);
+    pthread_cond_init(&latch->cond, NULL);
+    latch->pageNum = NO_PAGE;
+    return latch;
+}
+
+
+// Make the version odd: optimistic reads that overlap with what follows fail their validation
+static void lockVersion(FrameLatch *latch)
+{
+    __atomic_fetch_add(&latch->version, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); // ordered before the changes that follow
+}
+
+
+static void unlockVersion(FrameLatch *latch)
+{
+    __atomic_fetch_add(&latch->version, 1, __ATOMIC_RELEASE);
+}
+
+
+// The frame holds another page now, or none; called before the buffer of the old page is handed back
+static void frameChanged(BM_BufferPool *const bm, const int index)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *frame = &info->frames[index];
+    FrameLatch *latch = frame->latch;
+    info->framePages[index] = frame->page.pageNum;
+    info->frameFiles[index] = frame->page.fileId;
+    lockVersion(latch);
+    __atomic_store_n(&latch->pageNum, frame->page.pageNum, __ATOMIC_RELAXED);
+    __atomic_store_n(&latch->fileId, frame->page.fileId, __ATOMIC_RELAXED);
+    __atomic_store_n(&latch->data, frame->page.data, __ATOMIC_RELAXED);
+    unlockVersion(latch);
+}
+
+
+static void destroyLatch(FrameLatch *latch)
+{
+    pthread_mutex_destroy(&latch->mutex);
+    pthread_cond_destroy(&latch->cond);
+    free(latch);
+}
+
+
+// Function definitions
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData)
+{
+    SM_FileHandle fh;
+    if (openPageFile((char *)pageFileName, &fh) != RC_OK) // the page size comes from the page file
+        return RC_FILE_NOT_FOUND;
+
+    PoolInfo *info = (PoolInfo *)malloc(sizeof(PoolInfo));
+    PageFrames *pool = (PageFrames *)malloc(sizeof(PageFrames) * numPages); // Initialize bufferpool in memory
+    bm->pageFile = (char *const)pageFileName;
+    bm->numPages = numPages;
+    bm->pageSize = fh.pageSize;
+    bm->strategy = strategy;
+
+    int i;
+    for (i = 0; i < numPages; i++)
+    {
+        pool[i].is_Dirty = false;
+        pool[i].is_pinned = false;
+        pool[i].fixCount = 0;
+        pool[i].page.pageNum = NO_PAGE; // store NO_PAGE (-1) initially
+        pool[i].page.data = NULL;
+        pool[i].page.fileId = 0;
+        pool[i].writeCount = 0;
+        pool[i].score = 0;
+        pool[i].ref_bit = 0;
+        pool[i].pageLSN = NO_LSN;
+        pool[i].recLSN = NO_LSN;
+        pool[i].latch = createLatch();
+        pool[i].hint = BM_HINT_NORMAL;
+        pool[i].sticky = false;
+        pool[i].tenant = BM_DEFAULT_TENANT;
+    }
+
+    info->frames = pool;
+    info->files = (PoolFile *)malloc(sizeof(PoolFile));
+    info->files[0].fileName = (char *)malloc(strlen(pageFileName) + 1);
+    strcpy(info->files[0].fileName, pageFileName);
+    info->files[0].fh = fh;
+    info->files[0].fh.fileName = info->files[0].fileName;
+    info->files[0].quota = 0;
+    info->files[0].firstFreeMap = 0;
+    info->numFiles = 1;
+    info->readOnly = false;
+    info->mapped.base = NULL;
+    info->lastRequested = NO_PAGE;
+    info->seqRun = 0;
+    info->readAheadEnd = 0;
+    memset(info->aheadData, 0, sizeof(info->aheadData));
+    info->aheadStart = NO_PAGE;
+    info->advice = SM_ADVICE_NORMAL;
+    info->numReadIO = 0;
+    info->checksums = fh.checksums;
+    info->tier = NULL;
+    info->l2 = NULL;
+    info->log = NULL;
+    info->ckptTable = NULL;
+    info->ckptNumPages = 0;
+    info->ckptDone = 0;
+    info->ckptActive = false;
+    info->ckptBeginLSN = NO_LSN;
+    info->ckptRedoLSN = NO_LSN;
+    info->ckptThreadRunning = false;
+    info->ckptRate = 0;
+    info->ckptHurry = false;
+    info->warmSave = false;
+    info->warmTimerRunning = false;
+    info->warmStop = false;
+    info->warmInterval = 0;
+    info->warmUpRunning = false;
+    info->preloadPage = NO_PAGE;
+    info->preloadData = NULL;
+    info->numWarmed = 0;
+    for (i = 0; i < GHOST_PAGES; i++)
+    {
+        info->ghost[i] = NO_PAGE;
+        info->ghostFile[i] = 0;
+    }
+    info->ghostHead = 0;
+    memset(info->ghostHits, 0, sizeof(info->ghostHits));
+    memset(info->coldHits, 0, sizeof(info->coldHits));
+    info->retiredWrites = 0;
+    info->asyncReads = NULL;
+    info->completions = NULL;
+    info->lastCompletion = NULL;
+    info->numAsyncPending = 0;
+    info->numAsyncMerged = 0;
+    info->numAsyncThreads = 0;
+    info->asyncStop = false;
+    info->completionFd = -1;
+    pthread_cond_init(&info->asyncCond, NULL);
+    info->numLatchWaits = 0;
+    info->latchWaitMicros = 0;
+    info->retiredLatches = NULL;
+    info->framePages = NULL;
+    info->frameFiles = NULL;
+    info->freeFrames = NULL;
+    info->lowWatermark = 0;
+    info->highWatermark = 0;
+    info->lowWatermarkSet = 0;
+    info->highWatermarkSet = 0;
+    info->watermarkFrames = numPages;
+    info->evictorRunning = false;
+    info->evictStop = false;
+    info->numBackgroundEvictions = 0;
+    pthread_cond_init(&info->evictCond, NULL);
+    info->pinWaitMillis = DEFAULT_PIN_WAIT_MILLIS;
+    pthread_cond_init(&info->unpinCond, NULL);
+    info->numPinWaiters = 0;
+    info->numPinWaits = 0;
+    info->pinWaitMicros = 0;
+    info->numPinTimeouts = 0;
+    info->policy = (stratData != NULL) ? (const BM_ReplacementPolicy *)stratData : builtinPolicy(strategy);
+    info->frameptr = 0; // frameptr will point to 0th frame initially
+    info->cleanFirstMaxPercent = 0;
+    info->cleanFirstPercent = 0;
+    info->cleanFirstAdaptive = false;
+    info->readMicros = -1;
+    info->writeMicros = -1;
+    info->numCleanFirstEvictions = 0;
+    info->hintsUsed = false;
+    info->stickyPercent = DEFAULT_STICKY_PERCENT;
+    info->stickyPages = NULL;
+    info->stickyFiles = NULL;
+    info->numSticky = 0;
+    info->stickyCapacity = 0;
+    memset(info->tenants, 0, sizeof(info->tenants));
+    info->tenantQuotas = false;
+    pthread_mutex_init(&info->warmLock, NULL);
+    pthread_cond_init(&info->warmCond, NULL);
+
+    pthread_mutexattr_t attr; // recursive: eviction calls forcePage with the lock held
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&info->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    bm->mgmtData = info; // Store memory pointer to pool bookkeeping in mgmtData
+    rebuildFrameIndex(bm);
+    printf("buffer manager has been initialized\n");
+    
+    return RC_OK;
+}
+
+
+RC initBufferPoolReadOnly(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData)
+{
+    RC rc = initBufferPool(bm, pageFileName, numPages, strategy, stratData);
+    if (rc != RC_OK)
+        return rc;
+
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    rc = openMappedPageFile((char *)pageFileName, &info->mapped);
+    if (rc != RC_OK)
+    {
+        pthread_mutex_destroy(&info->lock);
+        pthread_mutex_destroy(&info->warmLock);
+        pthread_cond_destroy(&info->warmCond);
+        pthread_cond_destroy(&info->asyncCond);
+        pthread_cond_destroy(&info->evictCond);
+        pthread_cond_destroy(&info->unpinCond);
+        closePageFile(&info->files[0].fh);
+        free(info->files[0].fileName);
+        free(info->files);
+        for (i = 0; i < numPages; i++)
+            destroyLatch(info->frames[i].latch);
+        free(info->frames);
+        free(info->framePages);
+        free(info->frameFiles);
+        free(info->freeFrames);
+        free(info);
+        return rc;
+    }
+    info->readOnly = true;
+    return RC_OK;
+}
+
+
+RC setCompressedTierSize(BM_BufferPool *const bm, const size_t numBytes)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY; // mapped pages are already cached by the kernel
+
+    if (info->tier != NULL)
+        destroyCompressedTier(info->tier);
+    info->tier = (numBytes > 0) ? createCompressedTier(numBytes, bm->pageSize) : NULL;
+    return RC_OK;
+}
+
+
+RC attachL2Cache(BM_BufferPool *const bm, char *cacheFileName, const int numPages)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY;
+
+    if (info->l2 != NULL)
+        closeL2Cache(info->l2);
+    info->l2 = NULL;
+    if (numPages <= 0)
+        return RC_OK;
+    return openL2Cache(cacheFileName, numPages, bm->pageSize, &info->l2);
+}
+
+
+RC attachLog(BM_BufferPool *const bm, WAL_Log *log)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY;
+    info->log = log; // the log belongs to the caller, it may be shared by several pools
+    return RC_OK;
+}
+
+
+// Let the pool cache pages of another page file, pinned with pinFilePage under the returned id.
+// Registering a file twice returns its first id
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *fileId)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    SM_FileHandle fh;
+    int i;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY; // frames point into the mapping of the pool's own file
+
+    pthread_mutex_lock(&info->lock);
+    for (i = 0; i < info->numFiles; i++)
+    {
+        if (strcmp(info->files[i].fileName, pageFileName) == 0)
+        {
+            *fileId = i;
+            pthread_mutex_unlock(&info->lock);
+            return RC_OK;
+        }
+    }
+    if (openPageFile((char *)pageFileName, &fh) != RC_OK)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_FILE_NOT_FOUND;
+    }
+    if (fh.pageSize != bm->pageSize) // frame buffers are all of the pool's page size
+    {
+        closePageFile(&fh);
+        pthread_mutex_unlock(&info->lock);
+        return RC_INVALID_PAGE_SIZE;
+    }
+    info->files = (PoolFile *)realloc(info->files, sizeof(PoolFile) * (info->numFiles + 1));
+    PoolFile *file = &info->files[info->numFiles];
+    file->fileName = (char *)malloc(strlen(pageFileName) + 1);
+    strcpy(file->fileName, pageFileName);
+    file->fh = fh;
+    file->fh.fileName = file->fileName;
+    file->quota = 0;
+    file->firstFreeMap = 0;
+    *fileId = info->numFiles++;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Cap the frames holding pages of a file; once there, a miss on the file replaces its own coldest page
+RC setFileQuota(BM_BufferPool *const bm, const int fileId, const int maxFrames)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    if (fileId < 0 || fileId >= info->numFiles)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    info->files[fileId].quota = (maxFrames > 0) ? maxFrames : 0;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Frames kept for a tenant and the most it may hold (0 for no limit). The minimums of all tenants must fit in the pool
+RC setTenantQuota(BM_BufferPool *const bm, const int tenantId, const int minFrames, const int maxFrames)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int t, reserved = minFrames;
+    if (tenantId < 0 || tenantId >= MAX_TENANTS || minFrames < 0 || maxFrames < 0 || (maxFrames > 0 && minFrames > maxFrames))
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    for (t = 0; t < MAX_TENANTS; t++)
+    {
+        if (t != tenantId)
+            reserved += info->tenants[t].minFrames;
+    }
+    if (reserved > bm->numPages)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_ERROR;
+    }
+    info->tenants[tenantId].minFrames = minFrames;
+    info->tenants[tenantId].maxFrames = maxFrames;
+    info->tenantQuotas = true;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Frame holding a page, -1 if the page is not in the pool
+/*
+ * Lookups compare the page number against PoolInfo.framePages, eight frames per AVX2
+ * instruction when the CPU has it (checked at run time) or four with NEON, and check
+ * the file only of frames whose page number matched. The scalar loop does the rest.
+ */
+static int scanPagesScalar(const PageNumber *pages, int from, const int num, const PageNumber pageNum)
+{
+    for (; from < num; from++)
+    {
+        if (pages[from] == pageNum)
+            return from;
+    }
+    return -1;
+}
+
+
+#if FRAME_SCAN_X86
+__attribute__((target("avx2")))
+static int scanPagesVector(const PageNumber *pages, int from, const int num, const PageNumber pageNum)
+{
+    __m256i key = _mm256_set1_epi32(pageNum);
+    for (; from + 8 <= num; from += 8)
+    {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(pages + from)), key);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq)); // a bit per frame
+        if (mask != 0)
+            return from + __builtin_ctz(mask);
+    }
+    return scanPagesScalar(pages, from, num, pageNum);
+}
+#elif FRAME_SCAN_NEON
+static int scanPagesVector(const PageNumber *pages, int from, const int num, const PageNumber pageNum)
+{
+    int32x4_t key = vdupq_n_s32(pageNum);
+    for (; from + 4 <= num; from += 4)
+    {
+        if (vmaxvq_u32(vceqq_s32(vld1q_s32(pages + from), key)) != 0)
+            return scanPagesScalar(pages, from, from + 4, pageNum);
+    }
+    return scanPagesScalar(pages, from, num, pageNum);
+}
+#endif
+
+static int (*scanPages)(const PageNumber *, int, const int, const PageNumber);
+static pthread_once_t scanPagesOnce = PTHREAD_ONCE_INIT;
+
+
+static void initScanPages(void)
+{
+    scanPages = scanPagesScalar;
+#if FRAME_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        scanPages = scanPagesVector;
+#elif FRAME_SCAN_NEON
+    scanPages = scanPagesVector;
+#endif
+}
+
+
+// Frame holding the page, -1 if it isn't resident; with the lock held
+static int findFrame(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i = -1;
+    pthread_once(&scanPagesOnce, initScanPages);
+    while ((i = scanPages(info->framePages, i + 1, bm->numPages, pageNum)) >= 0)
+    {
+        if (info->frameFiles[i] == fileId)
+            return i;
+    }
+    return -1;
+}
+
+
+// Log the after-image of a byte range the client changed in a pinned page, and mark the page dirty
+RC logPageUpdate(BM_BufferPool *const bm, BM_PageHandle *const page, const int offset, const int length, LSN *lsn)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    int i;
+    if (info->log == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (offset < 0 || length < 0 || offset + length > bm->pageSize)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    if (page->fileId != 0)
+        return RC_FILE_HANDLE_NOT_INIT; // log records name pages of the pool's own file only
+
+    RC rc = RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    i = findFrame(bm, page->fileId, page->pageNum);
+    if (i >= 0)
+    {
+        LSN start = getLogEnd(info->log); // the record begins at or after this point
+        rc = appendLogRecord(info->log, WAL_PAGE_UPDATE, page->pageNum, offset, length, pool[i].page.data + offset, lsn);
+        if (rc == RC_OK)
+        {
+            if (!pool[i].is_Dirty)
+                pool[i].recLSN = start;
+            pool[i].pageLSN = *lsn;
+            pool[i].is_Dirty = true;
+        }
+    }
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+// An adaptive clean-first window follows the share of a write's time a read would not take: none while writes
+// cost no more than reads, close to the whole window once they cost several times more
+static void adaptCleanFirstWindow(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (!info->cleanFirstAdaptive || info->readMicros < 0 || info->writeMicros <= 0)
+        return; // not measured yet, the maximum stands
+    double share = 1 - info->readMicros / info->writeMicros;
+    info->cleanFirstPercent = (share <= 0) ? 0 : (int)(info->cleanFirstMaxPercent * share + 0.5);
+}
+
+
+// Fold the time since start into the moving average of reads or writes
+static void recordIoLatency(BM_BufferPool *const bm, double *average, const struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double micros = (end.tv_sec - start->tv_sec) * 1e6 + (end.tv_nsec - start->tv_nsec) / 1e3;
+    *average = (*average < 0) ? micros : *average + (micros - *average) / IO_LATENCY_WEIGHT;
+    adaptCleanFirstWindow(bm);
+}
+
+
+// Write a dirty frame back to its page file
+static RC writeFrame(BM_BufferPool *const bm, const int index)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int fileId = pool[index].page.fileId;
+    RC rc;
+    if (info->log != NULL && pool[index].pageLSN != NO_LSN)
+    {
+        rc = flushLog(info->log, pool[index].pageLSN); // write-ahead rule: log records before the page
+        if (rc != RC_OK)
+            return rc;
+    }
+    SM_PageHandle data = pool[index].page.data, copy = NULL;
+    // A pinned page (checkpoints write those) may be changed by its client while it is written. writeBlock stamps the
+    // checksum into the buffer it is given, so it gets a copy: what reaches the disk then matches its trailer
+    if (pool[index].fixCount > 0)
+    {
+        copy = allocPageBuffer(bm->pageSize);
+        memcpy(copy, data, bm->pageSize);
+        data = copy;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rc = writeBlock(pool[index].page.pageNum, &info->files[fileId].fh, data);
+    if (copy != NULL)
+        releasePageBuffer(bm->pageSize, copy);
+    if (rc != RC_OK)
+        return rc;
+    recordIoLatency(bm, &info->writeMicros, &start);
+    if (info->l2 != NULL && fileId == 0)
+        dropL2Page(info->l2, pool[index].page.pageNum); // the cached copy is stale now
+    if (fileId == 0)
+    {
+        dropReadAheadPage(bm, pool[index].page.pageNum);
+        markAsyncReadStale(bm, pool[index].page.pageNum);
+    }
+    if (copy != NULL) // the client may go on changing it without another markDirty: the page stays dirty
+        pool[index].recLSN = (info->log != NULL) ? getLogEnd(info->log) : NO_LSN; // later changes are logged from here
+    else
+    {
+        pool[index].is_Dirty = false;
+        pool[index].recLSN = NO_LSN;
+    }
+    pool[index].writeCount += 1;
+    return RC_OK;
+}
+
+
+RC shutdownBufferPool(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i;
+    if (info->ckptThreadRunning) // let a background checkpoint finish first, at full speed
+    {
+        pthread_mutex_lock(&info->lock);
+        info->ckptHurry = true;
+        pthread_mutex_unlock(&info->lock);
+        waitForCheckpoint(bm);
+    }
+    waitForWarmUp(bm);
+    pthread_mutex_lock(&info->lock);
+    int pending = info->numAsyncPending; // those pin pages yet, or hold pages their callers haven't seen
+    pthread_mutex_unlock(&info->lock);
+    if (pending > 0)
+        return RC_BUFFER_IN_USE_BY_CLIENT;
+    stopEvictor(bm); // it would evict behind the back of the loop below
+    for(i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].is_pinned == true)
+        {
+            startEvictor(bm); // the pool stays in use
+            return RC_BUFFER_IN_USE_BY_CLIENT; // return error if page is in use by a client
+        }
+
+        if (pool[i].is_Dirty == true)
+            forcePage(bm, &pool[i].page); // call forcepage to write back, if the page is dirty
+    }
+    if (info->warmTimerRunning)
+    {
+        pthread_mutex_lock(&info->warmLock);
+        info->warmStop = true;
+        pthread_cond_signal(&info->warmCond);
+        pthread_mutex_unlock(&info->warmLock);
+        pthread_join(info->warmTimer, NULL);
+    }
+    if (info->warmSave)
+        saveWarmList(bm); // for the warm-up of the next pool on this file
+    if (info->readOnly)
+        closeMappedPageFile(&info->mapped); // frames only pointed into the mapping
+    else
+    {
+        for (i = 0; i < bm->numPages; i++)
+        {
+            if (pool[i].page.data != NULL)
+                releasePageBuffer(bm->pageSize, pool[i].page.data); // hand page buffers back to the arena
+        }
+    }
+    stopAsyncIO(bm);
+    dropReadAhead(bm);
+    if (info->tier != NULL)
+        destroyCompressedTier(info->tier);
+    if (info->l2 != NULL)
+        closeL2Cache(info->l2);
+    pthread_mutex_destroy(&info->lock);
+    pthread_mutex_destroy(&info->warmLock);
+    pthread_cond_destroy(&info->warmCond);
+    pthread_cond_destroy(&info->asyncCond);
+    pthread_cond_destroy(&info->evictCond);
+    pthread_cond_destroy(&info->unpinCond);
+    for (i = 0; i < info->numFiles; i++)
+    {
+        closePageFile(&info->files[i].fh);
+        free(info->files[i].fileName);
+    }
+    free(info->files);
+    free(info->ckptTable);
+    for (i = 0; i < bm->numPages; i++)
+        destroyLatch(pool[i].latch);
+    while (info->retiredLatches != NULL)
+    {
+        FrameLatch *next = info->retiredLatches->nextRetired;
+        destroyLatch(info->retiredLatches);
+        info->retiredLatches = next;
+    }
+    free(pool); // free memory after everything is written on disk
+    free(info->stickyPages);
+    free(info->stickyFiles);
+    free(info->framePages);
+    free(info->frameFiles);
+    free(info->freeFrames);
+    free(info);
+    return RC_OK;
+}
+
+
+static RC forceFlushPoolLocked(BM_BufferPool *const bm)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i;
+    for(i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].is_pinned == true || pool[i].fixCount > 0)
+            return RC_BUFFER_IN_USE_BY_CLIENT;
+
+        else if (pool[i].is_Dirty == true)
+        {
+            RC rc = writeFrame(bm, i);
+            if (rc != RC_OK)
+                return rc;
+        }
+    }
+    return RC_OK;
+}
+
+
+RC forceFlushPool(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    RC rc = forceFlushPoolLocked(bm);
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    int i;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY; // pages of a read-only pool can never be written back
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    i = findFrame(bm, page->fileId, page->pageNum);
+    if (i >= 0)
+    {
+        if (!pool[i].is_Dirty && info->log != NULL)
+            pool[i].recLSN = getLogEnd(info->log); // changes from here on are not in the page file
+        pool[i].is_Dirty = true;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    int i;
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    i = findFrame(bm, page->fileId, page->pageNum);
+    if (i >= 0)
+    {
+        pool[i].fixCount -= 1;
+        if (pool[i].fixCount == 0)
+        {
+            pool[i].is_pinned = false;
+            if (info->policy->onUnpin != NULL)
+                info->policy->onUnpin(bm, info->policy->data, i);
+            if (pool[i].hint == BM_HINT_WILL_NOT_NEED)
+                dropFrame(bm, i); // a page that can't be written back stays, dirty, for a later write
+            if (info->numPinWaiters > 0)
+                pthread_cond_broadcast(&info->unpinCond); // a miss can have the frame now
+        }
+    }
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+static RC forcePageLocked (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i = findFrame(bm, page->fileId, page->pageNum);
+    if (i < 0)
+        return RC_OK;
+    if (pool[i].is_Dirty == false) 
+        return RC_PAGE_WAS_NOT_MODIFIED;  // return error if page remained unchanged while in buffer
+    return writeFrame(bm, i);
+}
+
+
+RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    RC rc = forcePageLocked(bm, page);
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+// First run of runLength clear bits among the numBits bits of a map page, -1 if there is none
+static int findFreeRun(const unsigned char *map, const int numBits, const int runLength)
+{
+    int i, run = 0;
+    for (i = 0; i < numBits; i++)
+    {
+        if ((i & 7) == 0 && map[i >> 3] == 0xFF) // eight pages in use, skip the byte
+        {
+            run = 0;
+            i += 7;
+        }
+        else if (map[i >> 3] & (1 << (i & 7)))
+            run = 0;
+        else if (++run == runLength)
+            return i - runLength + 1;
+    }
+    return -1;
+}
+
+
+static void setMapBits(unsigned char *map, const int first, const int count, const bool inUse)
+{
+    int i;
+    for (i = first; i < first + count; i++)
+    {
+        if (inUse)
+            map[i >> 3] |= 1 << (i & 7);
+        else
+            map[i >> 3] &= ~(1 << (i & 7));
+    }
+}
+
+
+// Hand out numPages contiguous free pages of a file with a free-space map, the first one in firstPage.
+// The map is searched from the start of the file, so tables stay packed and their extents sequential
+RC allocatePage(BM_BufferPool *const bm, const int fileId, const int numPages, PageNumber *firstPage)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    BM_PageHandle map;
+    RC rc = RC_OK;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY;
+
+    pthread_mutex_lock(&info->lock);
+    if (fileId < 0 || fileId >= info->numFiles)
+        rc = RC_FILE_HANDLE_NOT_INIT;
+    else if (!info->files[fileId].fh.freeSpaceMap)
+        rc = RC_NO_FREE_SPACE_MAP;
+    else if (numPages <= 0 || numPages > freeSpaceMapCapacity(&info->files[fileId].fh))
+        rc = RC_ERROR; // an extent never spans two map pages
+    if (rc != RC_OK)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return rc;
+    }
+
+    PoolFile *file = &info->files[fileId];
+    int capacity = freeSpaceMapCapacity(&file->fh);
+    PageNumber mapPage;
+    for (mapPage = file->firstFreeMap; ; mapPage += capacity + 1) // map pages past the end are all free, so this ends
+    {
+        rc = pinPageLocked(bm, &map, BM_DEFAULT_TENANT, fileId, mapPage);
+        if (rc != RC_OK)
+            break;
+        int bit = findFreeRun((unsigned char *)map.data, capacity, numPages);
+        if (bit >= 0)
+        {
+            setMapBits((unsigned char *)map.data, bit, numPages, true);
+            markDirty(bm, &map);
+            *firstPage = mapPage + 1 + bit;
+        }
+        else if (mapPage == file->firstFreeMap && findFreeRun((unsigned char *)map.data, capacity, 1) < 0)
+            file->firstFreeMap = mapPage + capacity + 1; // full, later searches start past it
+        unpinPage(bm, &map);
+        if (bit >= 0)
+            break;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+// Return numPages pages from firstPage to the free-space map. Their frames are dropped without being
+// written back and their disk space is punched out of the file, so they read as zeros when handed out again
+RC freePage(BM_BufferPool *const bm, const int fileId, const PageNumber firstPage, const int numPages)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    BM_PageHandle map;
+    RC rc = RC_OK;
+    int i, p, bit = -1;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY;
+
+    pthread_mutex_lock(&info->lock);
+    if (fileId < 0 || fileId >= info->numFiles)
+        rc = RC_FILE_HANDLE_NOT_INIT;
+    else if (!info->files[fileId].fh.freeSpaceMap)
+        rc = RC_NO_FREE_SPACE_MAP;
+    if (rc != RC_OK)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return rc;
+    }
+    PoolFile *file = &info->files[fileId];
+    PageNumber mapPage = freeSpaceMapPage(&file->fh, firstPage, &bit);
+    if (firstPage < 0 || bit < 0 || numPages <= 0 || bit + numPages > freeSpaceMapCapacity(&file->fh))
+        rc = RC_READ_NON_EXISTING_PAGE; // map pages can't be freed, and a range never spans two map pages
+    for (p = firstPage; rc == RC_OK && p < firstPage + numPages; p++)
+    {
+        i = findFrame(bm, fileId, p);
+        if (i >= 0 && info->frames[i].fixCount > 0)
+            rc = RC_BUFFER_IN_USE_BY_CLIENT;
+    }
+    if (rc == RC_OK)
+        rc = pinPageLocked(bm, &map, BM_DEFAULT_TENANT, fileId, mapPage);
+    if (rc != RC_OK)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return rc;
+    }
+    for (p = bit; p < bit + numPages; p++)
+    {
+        if (!(map.data[p >> 3] & (1 << (p & 7))))
+        {
+            unpinPage(bm, &map);
+            pthread_mutex_unlock(&info->lock);
+            return RC_READ_NON_EXISTING_PAGE; // not allocated
+        }
+    }
+
+    bool dropped = false;
+    pool = info->frames;
+    for (p = firstPage; p < firstPage + numPages; p++)
+    {
+        i = findFrame(bm, fileId, p);
+        if (i >= 0)
+        {
+            discardFrame(bm, i); // the page's contents are gone, nothing to write back
+            clearFrame(&pool[i]);
+            setFrameFree(bm, i, true);
+            dropped = true;
+        }
+        if (fileId == 0 && info->tier != NULL)
+            dropCompressedPage(info->tier, p);
+        if (fileId == 0 && info->l2 != NULL)
+            dropL2Page(info->l2, p);
+        if (fileId == 0)
+        {
+            dropReadAheadPage(bm, p);
+            markAsyncReadStale(bm, p);
+        }
+    }
+    if (dropped && bm->strategy == RS_LRU)
+        renumberLRUScores(bm);
+    setMapBits((unsigned char *)map.data, bit, numPages, false);
+    markDirty(bm, &map);
+    unpinPage(bm, &map);
+    if (mapPage < file->firstFreeMap)
+        file->firstFreeMap = mapPage;
+    rc = punchBlocks(firstPage, numPages, &file->fh);
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+// Smallest recLSN among the dirty frames, the log from there on is still needed for redo.
+// A recLSN of 0 is the start of the log, so numDirty tells whether there was any
+static LSN oldestDirtyLSN(BM_BufferPool *const bm, int *numDirty)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    LSN oldest = NO_LSN;
+    int i;
+    *numDirty = 0;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].is_Dirty && (*numDirty == 0 || pool[i].recLSN < oldest))
+            oldest = pool[i].recLSN;
+        if (pool[i].is_Dirty)
+            *numDirty += 1;
+    }
+    return oldest;
+}
+
+
+// Take the dirty page table and log it, checkpointStep then writes those pages out while the pool stays in use
+RC beginCheckpoint(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    RC rc = RC_OK;
+    int i, n = 0;
+    if (info->readOnly)
+        return RC_POOL_IS_READ_ONLY;
+
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    if (info->ckptActive)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_CHECKPOINT_IN_PROGRESS;
+    }
+    free(info->ckptTable);
+    info->ckptTable = (WAL_DirtyPage *)malloc(sizeof(WAL_DirtyPage) * bm->numPages);
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].is_Dirty && pool[i].page.pageNum != NO_PAGE)
+        {
+            info->ckptTable[n].fileId = pool[i].page.fileId;
+            info->ckptTable[n].pageNum = pool[i].page.pageNum;
+            info->ckptTable[n].recLSN = pool[i].recLSN;
+            n++;
+        }
+    }
+    info->ckptNumPages = n;
+    info->ckptDone = 0;
+    info->ckptBeginLSN = NO_LSN;
+    if (info->log != NULL)
+    {
+        LSN lsn;
+        info->ckptBeginLSN = getLogEnd(info->log);
+        rc = appendLogRecord(info->log, WAL_CHECKPOINT_BEGIN, -1, 0, sizeof(WAL_DirtyPage) * n, (char *)info->ckptTable, &lsn);
+    }
+    info->ckptActive = (rc == RC_OK);
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+// All pages of the table are out: everything before the redo LSN is no longer needed for recovery
+static RC finishCheckpoint(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    info->ckptActive = false;
+    if (info->log == NULL)
+        return RC_OK;
+
+    int numDirty;
+    LSN redo = oldestDirtyLSN(bm, &numDirty);
+    LSN lsn;
+    if (numDirty == 0 || redo > info->ckptBeginLSN) // pages dirtied later are covered by starting at the begin record
+        redo = info->ckptBeginLSN;
+    RC rc = appendLogRecord(info->log, WAL_CHECKPOINT_END, -1, 0, sizeof(LSN), (char *)&redo, &lsn);
+    if (rc == RC_OK)
+        rc = flushLog(info->log, lsn);
+    if (rc == RC_OK)
+        info->ckptRedoLSN = redo;
+    return rc;
+}
+
+
+// Write up to maxPages pages of the running checkpoint, pages cleaned in the meantime are skipped for free
+RC checkpointStep(BM_BufferPool *const bm, const int maxPages)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    RC rc = RC_OK;
+    int i, written = 0;
+
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    while (info->ckptActive && info->ckptDone < info->ckptNumPages && written < maxPages)
+    {
+        WAL_DirtyPage *entry = &info->ckptTable[info->ckptDone];
+        i = findFrame(bm, entry->fileId, entry->pageNum);
+        if (i >= 0 && pool[i].is_Dirty) // pinned pages are written too, and stay dirty for later changes
+        {
+            rc = writeFrame(bm, i);
+            if (rc != RC_OK)
+                break;
+            written++;
+        }
+        info->ckptDone += 1;
+    }
+    if (rc == RC_OK && info->ckptActive && info->ckptDone == info->ckptNumPages)
+        rc = finishCheckpoint(bm);
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+static void *checkpointWorker(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    bool active = true;
+    while (active)
+    {
+        if (checkpointStep(bm, 1) != RC_OK)
+            break;
+        pthread_mutex_lock(&info->lock);
+        active = info->ckptActive;
+        bool hurry = info->ckptHurry;
+        pthread_mutex_unlock(&info->lock);
+        if (active && !hurry)
+            usleep(1000000 / info->ckptRate); // trickle, so checkpoint writes don't crowd out misses
+    }
+    return NULL;
+}
+
+
+// Begin a checkpoint and write its pages from a background thread at pagesPerSecond
+RC startCheckpoint(BM_BufferPool *const bm, const int pagesPerSecond)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->ckptThreadRunning)
+        return RC_CHECKPOINT_IN_PROGRESS;
+    RC rc = beginCheckpoint(bm);
+    if (rc != RC_OK)
+        return rc;
+
+    info->ckptRate = (pagesPerSecond > 0) ? pagesPerSecond : 1;
+    info->ckptHurry = false;
+    if (pthread_create(&info->ckptThread, NULL, checkpointWorker, bm) != 0)
+        return RC_ERROR; // the checkpoint stays active, checkpointStep can still finish it
+    info->ckptThreadRunning = true;
+    return RC_OK;
+}
+
+
+// Block until the current checkpoint is complete, writing its remaining pages here if no thread does
+RC waitForCheckpoint(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->ckptThreadRunning)
+    {
+        pthread_join(info->ckptThread, NULL);
+        info->ckptThreadRunning = false;
+    }
+    return checkpointStep(bm, INT_MAX);
+}
+
+
+RC getCheckpointStatus(BM_BufferPool *const bm, BM_CheckpointStatus *status)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    status->active = info->ckptActive;
+    status->numPages = info->ckptNumPages;
+    status->pagesDone = info->ckptDone;
+    status->beginLSN = info->ckptBeginLSN;
+    status->oldestDirtyLSN = oldestDirtyLSN(bm, &status->numDirtyPages);
+    status->redoLSN = info->ckptRedoLSN;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Feed the order in which a read-only pool reads pages back to the kernel as madvise hints
+static void adviseAccess(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (pageNum == info->lastRequested + 1)
+        info->seqRun += 1;
+    else
+        info->seqRun = 0;
+    info->lastRequested = pageNum;
+
+    if (info->seqRun >= SEQ_RUN_THRESHOLD) // scan: read ahead by one pool's worth of pages
+    {
+        if (info->advice != SM_ADVICE_SEQUENTIAL)
+        {
+            adviseBlocks(0, info->mapped.totalNumPages, &info->mapped, SM_ADVICE_SEQUENTIAL);
+            info->advice = SM_ADVICE_SEQUENTIAL;
+            info->readAheadEnd = pageNum + 1;
+        }
+        if (info->readAheadEnd < pageNum + 1)
+            info->readAheadEnd = pageNum + 1;
+        if (info->readAheadEnd - pageNum <= bm->numPages / 2) // refill the window once it is half consumed
+        {
+            adviseBlocks(info->readAheadEnd, bm->numPages, &info->mapped, SM_ADVICE_WILLNEED);
+            info->readAheadEnd += bm->numPages;
+        }
+    }
+    else if (info->seqRun == 0 && info->advice != SM_ADVICE_RANDOM) // random lookups: no read ahead
+    {
+        adviseBlocks(0, info->mapped.totalNumPages, &info->mapped, SM_ADVICE_RANDOM);
+        info->advice = SM_ADVICE_RANDOM;
+    }
+}
+
+
+// Misses on consecutive pages of the pool's own file look like a scan: read the next READ_AHEAD_PAGES pages
+// with one readBlocks and serve the following misses from those copies. NULL when the page has to be read alone
+static SM_PageHandle readAhead(BM_BufferPool *const bm, SM_FileHandle *fh, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    SM_PageHandle pages[READ_AHEAD_PAGES];
+    int k = pageNum - info->aheadStart;
+    if (pageNum == info->lastRequested + 1)
+        info->seqRun += 1;
+    else
+        info->seqRun = 0;
+    info->lastRequested = pageNum;
+
+    if (info->aheadStart != NO_PAGE && k >= 0 && k < READ_AHEAD_PAGES && info->aheadData[k] != NULL)
+    {
+        SM_PageHandle ph = info->aheadData[k];
+        info->aheadData[k] = NULL;
+        return ph;
+    }
+    if (info->seqRun < SEQ_RUN_THRESHOLD)
+        return NULL;
+
+    int count = (fh->totalNumPages - pageNum < READ_AHEAD_PAGES) ? fh->totalNumPages - pageNum : READ_AHEAD_PAGES;
+    dropReadAhead(bm); // copies left over from the last window were skipped by the scan
+    for (k = 0; k < count; k++)
+        pages[k] = allocPageBuffer(bm->pageSize);
+    if (readBlocks(pageNum, count, fh, pages) != RC_OK) // a damaged page: let the single read report it
+    {
+        for (k = 0; k < count; k++)
+            releasePageBuffer(bm->pageSize, pages[k]);
+        return NULL;
+    }
+    info->aheadStart = pageNum;
+    info->aheadData[0] = NULL;
+    for (k = 1; k < count; k++)
+        info->aheadData[k] = pages[k];
+    return pages[0];
+}
+
+
+// Bring pageNum in for a frame: copy it from disk, or point into the mapping for read-only pools.
+// The compressed tier and the L2 cache only hold pages of the pool's own file
+static RC loadPage(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum, SM_PageHandle *data)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->preloadData != NULL && fileId == 0 && pageNum == info->preloadPage) // read by the warm-up already
+    {
+        *data = info->preloadData;
+        info->preloadData = NULL;
+        return RC_OK;
+    }
+    if (info->readOnly)
+    {
+        RC rc = mapBlock(pageNum, &info->mapped, data); // pages past the end can't be appended here
+        if (rc == RC_OK)
+        {
+            adviseAccess(bm, pageNum);
+            info->numReadIO += 1;
+        }
+        return rc;
+    }
+
+    SM_FileHandle *fh = &info->files[fileId].fh;
+    SM_PageHandle ph = allocPageBuffer(bm->pageSize);
+    if (fileId == 0 && info->tier != NULL && takeCompressedPage(info->tier, pageNum, ph)) // evicted earlier, no I/O needed
+    {
+        *data = ph;
+        return RC_OK;
+    }
+    if (fileId == 0 && info->l2 != NULL && getL2Page(info->l2, pageNum, ph)) // local copy, cheaper than the page file
+    {
+        if (!info->checksums || verifyPageChecksum(ph, bm->pageSize))
+        {
+            *data = ph;
+            return RC_OK;
+        }
+        dropL2Page(info->l2, pageNum); // damaged copy, the page file still has the page
+    }
+    if (pageNum >= fh->totalNumPages)
+        refreshPageCount(fh); // another handle may have grown the file
+    if (pageNum >= fh->totalNumPages) // never written: known to be zeros, the file grows when a write-back reaches it
+    {
+        memset(ph, 0, bm->pageSize);
+        *data = ph;
+        return RC_OK;
+    }
+    SM_PageHandle ahead = (fileId == 0) ? readAhead(bm, fh, pageNum) : NULL;
+    if (ahead != NULL) // read pages are counted when a frame takes them
+    {
+        releasePageBuffer(bm->pageSize, ph);
+        info->numReadIO += 1;
+        *data = ahead;
+        return RC_OK;
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    RC rc = readBlock(pageNum, fh, ph); // checks the trailer of checksummed files
+    recordIoLatency(bm, &info->readMicros, &start);
+    info->numReadIO += 1;
+    if (rc != RC_OK)
+    {
+        releasePageBuffer(bm->pageSize, ph);
+        return rc;
+    }
+    *data = ph;
+    return RC_OK;
+}
+
+
+// Count a hit by the number of frames colder than the one hit, empty frames being the coldest
+static void recordHit(BM_BufferPool *const bm, const int index)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i, rank = 0, hot = frameHotness(bm, index);
+    for (i = 0; i < bm->numPages && rank < GHOST_PAGES; i++) // ranks past the ghost list aren't counted
+    {
+        if (info->framePages[i] == NO_PAGE || (i != index && frameHotness(bm, i) < hot))
+            rank++;
+    }
+    if (rank < GHOST_PAGES)
+        info->coldHits[rank] += 1;
+}
+
+
+// Count a miss on a page evicted recently, by how many evictions ago that was
+static void recordMiss(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int r;
+    for (r = 0; r < GHOST_PAGES; r++)
+    {
+        int slot = (info->ghostHead - 1 - r + GHOST_PAGES) % GHOST_PAGES;
+        if (info->ghost[slot] == pageNum && info->ghostFile[slot] == fileId)
+        {
+            info->ghostHits[r] += 1;
+            info->ghost[slot] = NO_PAGE;
+            break;
+        }
+    }
+}
+
+
+// Coldest unpinned frame of a file that holds its quota of frames, -1 if it is below its quota or has none to give
+static int quotaVictim(BM_BufferPool *const bm, const int fileId)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i, victim = -1, count = 0;
+    if (info->files[fileId].quota == 0)
+        return -1;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE || pool[i].page.fileId != fileId)
+            continue;
+        count++;
+        if (pool[i].fixCount == 0 && (victim < 0 || frameHotness(bm, i) < frameHotness(bm, victim)))
+            victim = i;
+    }
+    return (count >= info->files[fileId].quota) ? victim : -1;
+}
+
+
+// Sticky pages, and keep-hot ones until they are passed over once, are kept while other pages can go
+static bool isProtected(const PageFrames *frame)
+{
+    return frame->sticky || frame->hint == BM_HINT_KEEP_HOT;
+}
+
+
+// Where the page is in the sticky set, -1 if it isn't
+static int stickyIndex(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    for (i = 0; i < info->numSticky; i++)
+    {
+        if (info->stickyPages[i] == pageNum && info->stickyFiles[i] == fileId)
+            return i;
+    }
+    return -1;
+}
+
+
+// Pin hints and sticky pages overrule the policy's victim: an evict-soon page goes first, coldest first by the
+// strategy's bookkeeping. A keep-hot victim is passed over for the coldest unprotected page and counts as used, once;
+// a sticky one only goes when every other unpinned page is sticky, keep-hot pages going before it
+static int hintVictim(BM_BufferPool *const bm, const int victim)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i, soon = -1, plain = -1, hot = -1;
+    if (!info->hintsUsed)
+        return victim;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE || pool[i].fixCount > 0 || pool[i].is_pinned)
+            continue;
+        int *best = (pool[i].hint == BM_HINT_EVICT_SOON || pool[i].hint == BM_HINT_WILL_NOT_NEED) ? &soon
+                : !isProtected(&pool[i]) ? &plain : !pool[i].sticky ? &hot : NULL;
+        if (best != NULL && (*best < 0 || frameHotness(bm, i) < frameHotness(bm, *best)))
+            *best = i;
+    }
+    if (soon >= 0)
+        return soon;
+    if (!isProtected(&pool[victim]))
+        return victim;
+    if (plain < 0) // nothing unprotected left
+        return (pool[victim].sticky && hot >= 0) ? hot : victim;
+    if (!pool[victim].sticky)
+    {
+        pool[victim].hint = BM_HINT_NORMAL;
+        if (info->policy->onHit != NULL)
+            info->policy->onHit(bm, info->policy->data, victim);
+    }
+    return plain;
+}
+
+
+// Clean-first: a dirty victim of a built-in policy gives way to the coldest clean unpinned frame, if that one is
+// among the coldest cleanFirstPercent of the frames. Saves the write-back, at the price of evicting a warmer page
+static int cleanFirstVictim(BM_BufferPool *const bm, const int victim)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i, clean = -1, rank = 0, hot;
+    if (info->cleanFirstPercent == 0 || !pool[victim].is_Dirty || info->policy != builtinPolicy(bm->strategy)
+            || pool[victim].hint == BM_HINT_EVICT_SOON)
+        return victim; // a client policy's order is its own, a hint is the client's word
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum != NO_PAGE && pool[i].fixCount == 0 && !pool[i].is_Dirty && !isProtected(&pool[i])
+                && (clean < 0 || frameHotness(bm, i) < frameHotness(bm, clean)))
+            clean = i;
+    }
+    if (clean < 0)
+        return victim;
+    hot = frameHotness(bm, clean);
+    for (i = 0; i < bm->numPages; i++) // its place in the replacement order
+    {
+        if (pool[i].page.pageNum != NO_PAGE && pool[i].fixCount == 0 && frameHotness(bm, i) < hot)
+            rank++;
+    }
+    if (rank * 100 >= bm->numPages * info->cleanFirstPercent)
+        return victim;
+    info->numCleanFirstEvictions += 1;
+    return clean;
+}
+
+
+// Frames holding pages charged to each tenant
+static void countTenantFrames(BM_BufferPool *const bm, int counts[MAX_TENANTS])
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i;
+    memset(counts, 0, sizeof(int) * MAX_TENANTS);
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum != NO_PAGE)
+            counts[pool[i].tenant] += 1;
+    }
+}
+
+
+// Coldest unpinned frame of a tenant that holds its maximum of frames, -1 if it is below it or has none to give
+static int tenantQuotaVictim(BM_BufferPool *const bm, const int tenantId)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i, victim = -1, count = 0;
+    if (info->tenants[tenantId].maxFrames == 0)
+        return -1;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE || pool[i].tenant != tenantId)
+            continue;
+        count++;
+        if (pool[i].fixCount == 0 && (victim < 0 || frameHotness(bm, i) < frameHotness(bm, victim)))
+            victim = i;
+    }
+    return (count >= info->tenants[tenantId].maxFrames) ? victim : -1;
+}
+
+
+// Tenant quotas have the last word on a victim: the coldest page of a tenant over its maximum goes first, then the
+// victim chosen so far if its tenant holds more than its minimum, else the coldest page of a tenant that does.
+// Sticky pages stay out of it; with nothing else to take, the victim stands
+static int tenantVictim(BM_BufferPool *const bm, const int victim)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int counts[MAX_TENANTS];
+    int i, over = -1, spare = -1;
+    if (!info->tenantQuotas)
+        return victim;
+    countTenantFrames(bm, counts);
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE || pool[i].fixCount > 0 || pool[i].is_pinned || pool[i].sticky)
+            continue;
+        PoolTenant *t = &info->tenants[pool[i].tenant];
+        if (t->maxFrames > 0 && counts[pool[i].tenant] > t->maxFrames
+                && (over < 0 || frameHotness(bm, i) < frameHotness(bm, over)))
+            over = i;
+        if (counts[pool[i].tenant] > t->minFrames && (spare < 0 || frameHotness(bm, i) < frameHotness(bm, spare)))
+            spare = i;
+    }
+    if (over >= 0)
+        return over;
+    if (counts[pool[victim].tenant] > info->tenants[pool[victim].tenant].minFrames)
+        return victim;
+    return (spare >= 0) ? spare : victim;
+}
+
+
+// Keep the free-frame bitmap in step with a frame that was emptied or filled; with the lock held
+static void setFrameFree(BM_BufferPool *const bm, const int index, const bool isFree)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    unsigned long bit = 1UL << (index % FRAME_BITS);
+    unsigned long *word = &info->freeFrames[index / FRAME_BITS];
+    if (isFree && !(*word & bit))
+        info->numFree += 1;
+    else if (!isFree && (*word & bit))
+    {
+        info->numFree -= 1;
+        if (info->evictorRunning && info->numFree < info->lowWatermark)
+            pthread_cond_signal(&info->evictCond); // refill before misses have to evict inline
+    }
+    *word = isFree ? (*word | bit) : (*word & ~bit);
+}
+
+
+// Lowest free frame, the one a scan for NO_PAGE would find first; -1 if all hold pages
+static int firstFreeFrame(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int w, numWords = (bm->numPages + FRAME_BITS - 1) / FRAME_BITS;
+    if (info->numFree == 0)
+        return -1;
+    for (w = 0; w < numWords; w++)
+    {
+        if (info->freeFrames[w] != 0)
+            return w * FRAME_BITS + __builtin_ctzl(info->freeFrames[w]);
+    }
+    return -1;
+}
+
+
+// Set up the page arrays and the free bitmap from the frames, for a new pool or after resizeBufferPool moved them around
+static void rebuildFrameIndex(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i, numWords = (bm->numPages + FRAME_BITS - 1) / FRAME_BITS;
+    info->framePages = (PageNumber *)realloc(info->framePages, sizeof(PageNumber) * bm->numPages);
+    info->frameFiles = (int *)realloc(info->frameFiles, sizeof(int) * bm->numPages);
+    info->freeFrames = (unsigned long *)realloc(info->freeFrames, sizeof(unsigned long) * numWords);
+    memset(info->freeFrames, 0, sizeof(unsigned long) * numWords);
+    info->numFree = 0;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        info->framePages[i] = info->frames[i].page.pageNum;
+        info->frameFiles[i] = info->frames[i].page.fileId;
+        if (info->frames[i].page.pageNum == NO_PAGE)
+            setFrameFree(bm, i, true);
+    }
+}
+
+
+static bool hasUnpinnedFrame(BM_BufferPool *const bm)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].fixCount == 0 && !pool[i].is_pinned)
+            return true;
+    }
+    return false;
+}
+
+
+// Put a page just read in into a frame, pinned once, and tell the policy
+static void installPage(BM_BufferPool *const bm, const int index, const int fileId, const PageNumber pageNum, SM_PageHandle ph)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *frame = &info->frames[index];
+    frame->page.data = ph;
+    frame->page.pageNum = pageNum;
+    frame->page.fileId = fileId;
+    frame->is_pinned = true;
+    frame->is_Dirty = false;
+    frame->fixCount = 1;
+    frame->ref_bit = 1; // Set reference bit to 1 (used by clock alg)
+    frame->hint = BM_HINT_NORMAL;
+    frame->sticky = stickyIndex(bm, fileId, pageNum) >= 0;
+    frameChanged(bm, index);
+    if (info->policy->onLoad != NULL)
+        info->policy->onLoad(bm, info->policy->data, index);
+}
+
+
+static RC pinPageLocked (BM_BufferPool *const bm, BM_PageHandle *const page, const int tenantId, const int fileId, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    const BM_ReplacementPolicy *policy = info->policy;
+    SM_PageHandle ph;
+    RC rc;
+    // Check if buffer manager already has the requested page
+    int index = findFrame(bm, fileId, pageNum);
+    if (index >= 0) // Found requested page in buffer pool
+    {
+        pool[index].fixCount += 1;  // increase fixCount of that frame
+        pool[index].is_pinned = true;
+        info->tenants[tenantId].numHits += 1;
+        recordHit(bm, index);
+        if (policy->onHit != NULL)
+            policy->onHit(bm, policy->data, index);
+    }
+    else if (info->numFree == 0 && !hasUnpinnedFrame(bm))
+        return RC_ALL_FRAMES_PINNED; // nothing to replace; the strategies would go round forever
+    else
+    {
+        info->tenants[tenantId].numMisses += 1;
+        recordMiss(bm, fileId, pageNum);
+        rc = loadPage(bm, fileId, pageNum, &ph);  // read page from disk before a frame is given up for it
+        if (rc != RC_OK)
+            return rc;
+        if ((index = quotaVictim(bm, fileId)) >= 0) // file at its quota: replace its own coldest page
+            rc = evictFrame(bm, index);
+        else if ((index = tenantQuotaVictim(bm, tenantId)) >= 0) // the same for a tenant at its maximum
+            rc = evictFrame(bm, index);
+        else if ((index = firstFreeFrame(bm)) >= 0) // take a free frame
+            setFrameFree(bm, index, false);
+        else // replace an existing page, chosen by the policy
+        {
+            if (info->evictorRunning)
+                pthread_cond_signal(&info->evictCond); // the free frames ran dry
+            index = policy->chooseVictim(bm, policy->data);
+            if (index < 0 || index >= bm->numPages || pool[index].fixCount > 0 || pool[index].is_pinned)
+            {
+                if (!info->readOnly)
+                    releasePageBuffer(bm->pageSize, ph);
+                return (index < 0 && !hasUnpinnedFrame(bm)) ? RC_ALL_FRAMES_PINNED : RC_ERROR;
+            }
+            index = hintVictim(bm, index);
+            index = cleanFirstVictim(bm, index);
+            index = tenantVictim(bm, index);
+            rc = evictFrame(bm, index); // write back the page if it was modified in this frame
+        }
+        if (rc != RC_OK) // the victim could not be written back and keeps its page
+        {
+            if (!info->readOnly)
+                releasePageBuffer(bm->pageSize, ph);
+            return rc;
+        }
+        installPage(bm, index, fileId, pageNum, ph);
+        pool[index].tenant = tenantId;
+    }
+
+    //Store the information into page which is used by the client
+    
+    page->pageNum = pageNum;
+    page->data = pool[index].page.data;
+    page->fileId = fileId;
+    return RC_OK;
+}
+
+
+RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    return pinFilePage(bm, page, 0, pageNum);
+}
+
+
+RC pinPageWithHint (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_PinHint hint)
+{
+    return pinFilePageWithHint(bm, page, 0, pageNum, hint);
+}
+
+
+// Every frame is pinned: sleep until unpinPage frees one, then try again, for up to pinWaitMillis. With the lock held
+static RC waitForUnpinnedFrame(BM_BufferPool *const bm, BM_PageHandle *const page, const int tenantId, const int fileId, const PageNumber pageNum)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    struct timespec start, end, due;
+    RC rc = RC_ALL_FRAMES_PINNED;
+    if (info->pinWaitMillis > 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        clock_gettime(CLOCK_REALTIME, &due);
+        due.tv_sec += info->pinWaitMillis / 1000;
+        due.tv_nsec += (long)(info->pinWaitMillis % 1000) * 1000000;
+        if (due.tv_nsec >= 1000000000)
+        {
+            due.tv_sec += 1;
+            due.tv_nsec -= 1000000000;
+        }
+        info->numPinWaiters += 1;
+        while (rc == RC_ALL_FRAMES_PINNED && pthread_cond_timedwait(&info->unpinCond, &info->lock, &due) != ETIMEDOUT)
+            rc = pinPageLocked(bm, page, tenantId, fileId, pageNum); // another miss may have taken the frame first
+        if (rc == RC_ALL_FRAMES_PINNED)
+            rc = pinPageLocked(bm, page, tenantId, fileId, pageNum); // an unpin can come together with the timeout
+        info->numPinWaiters -= 1;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        info->numPinWaits += 1;
+        info->pinWaitMicros += (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000;
+    }
+    if (rc == RC_ALL_FRAMES_PINNED)
+        info->numPinTimeouts += 1;
+    return rc;
+}
+
+
+// Pin a page of a file registered with registerPageFile
+RC pinFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId, const PageNumber pageNum)
+{
+    return pinFilePageWithHint(bm, page, fileId, pageNum, BM_HINT_NORMAL);
+}
+
+
+// Pin a page and say what to expect of it; the hint replaces the one of the page's previous pin
+RC pinFilePageWithHint (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId, const PageNumber pageNum, const BM_PinHint hint)
+{
+    return pinPageForTenant(bm, page, BM_DEFAULT_TENANT, fileId, pageNum, hint);
+}
+
+
+// Pin on behalf of a tenant: counted in its statistics, and a miss is read into a frame charged to it
+RC pinPageForTenant (BM_BufferPool *const bm, BM_PageHandle *const page, const int tenantId, const int fileId, const PageNumber pageNum,
+        const BM_PinHint hint)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (hint < BM_HINT_NORMAL || hint > BM_HINT_WILL_NOT_NEED || tenantId < 0 || tenantId >= MAX_TENANTS)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    if (fileId < 0 || fileId >= info->numFiles)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    RC rc = pinPageLocked(bm, page, tenantId, fileId, pageNum);
+    if (rc == RC_ALL_FRAMES_PINNED)
+        rc = waitForUnpinnedFrame(bm, page, tenantId, fileId, pageNum);
+    if (rc == RC_OK)
+    {
+        info->frames[findFrame(bm, fileId, pageNum)].hint = hint;
+        if (hint != BM_HINT_NORMAL)
+            info->hintsUsed = true;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+/*
+ * pinPageAsync misses are read by a set of I/O threads without the pool lock, so one
+ * caller can have many misses in flight. A finished read is installed like a warm-up
+ * page, through preloadData, and every request that waited for it is pinned and moved
+ * to the completion list. Callbacks only run in pollPinCompletions, on the caller's thread.
+ */
+static void *asyncReader(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    while (!info->asyncStop)
+    {
+        AsyncRead *read, **link;
+        for (read = info->asyncReads; read != NULL && read->started; read = read->next)
+            ;
+        if (read == NULL)
+        {
+            pthread_cond_wait(&info->asyncCond, &info->lock);
+            continue;
+        }
+        read->started = true;
+        SM_FileHandle fh = info->files[0].fh; // own copy, readBlock moves its current page
+        SM_PageHandle ph = allocPageBuffer(bm->pageSize);
+        RC rc;
+        do
+        {
+            read->stale = false;
+            pthread_mutex_unlock(&info->lock);
+            rc = readBlock(read->pageNum, &fh, ph);
+            pthread_mutex_lock(&info->lock);
+            info->numReadIO += 1;
+        } while (read->stale);
+
+        for (link = &info->asyncReads; *link != read; link = &(*link)->next)
+            ;
+        *link = read->next;
+        if (rc == RC_OK && info->tier != NULL)
+            dropCompressedPage(info->tier, read->pageNum); // the frame gets the page, the tier mustn't keep a second copy
+        info->preloadPage = read->pageNum;
+        info->preloadData = (rc == RC_OK) ? ph : NULL;
+        while (read->waiters != NULL)
+        {
+            AsyncWaiter *waiter = read->waiters;
+            read->waiters = waiter->next;
+            waiter->rc = (rc == RC_OK) ? pinPageLocked(bm, waiter->page, BM_DEFAULT_TENANT, 0, read->pageNum) : rc;
+            waiter->next = NULL;
+            if (info->lastCompletion != NULL)
+                info->lastCompletion->next = waiter;
+            else
+                info->completions = waiter;
+            info->lastCompletion = waiter;
+        }
+        if (info->preloadData != NULL || rc != RC_OK) // the page was resident by now, or there was nothing to install
+            releasePageBuffer(bm->pageSize, ph);
+        info->preloadPage = NO_PAGE;
+        info->preloadData = NULL;
+        free(read);
+        uint64_t one = 1;
+        if (write(info->completionFd, &one, sizeof(one)) < 0)
+            ; // the counter only saturates, the poll finds the completions all the same
+        pthread_cond_broadcast(&info->asyncCond);
+    }
+    pthread_mutex_unlock(&info->lock);
+    return NULL;
+}
+
+
+// With the lock held
+static RC startAsyncIO(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->numAsyncThreads > 0)
+        return RC_OK;
+    info->completionFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (info->completionFd < 0)
+        return RC_ERROR;
+    info->asyncStop = false;
+    while (info->numAsyncThreads < ASYNC_IO_THREADS
+            && pthread_create(&info->asyncThreads[info->numAsyncThreads], NULL, asyncReader, bm) == 0)
+        info->numAsyncThreads++;
+    return (info->numAsyncThreads > 0) ? RC_OK : RC_ERROR;
+}
+
+
+static void stopAsyncIO(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    pthread_mutex_lock(&info->lock);
+    info->asyncStop = true;
+    pthread_cond_broadcast(&info->asyncCond);
+    pthread_mutex_unlock(&info->lock);
+    for (i = 0; i < info->numAsyncThreads; i++)
+        pthread_join(info->asyncThreads[i], NULL);
+    info->numAsyncThreads = 0;
+    if (info->completionFd >= 0)
+        close(info->completionFd);
+    info->completionFd = -1;
+}
+
+
+// A read of pageNum that began before the page was written or freed returned the old contents
+static void markAsyncReadStale(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+    AsyncRead *read;
+    for (read = ((PoolInfo *)bm->mgmtData)->asyncReads; read != NULL; read = read->next)
+    {
+        if (read->pageNum == pageNum && read->started)
+            read->stale = true;
+    }
+}
+
+
+// Pin pageNum without waiting for the disk. RC_OK: the page was resident or needed no read and is pinned like
+// pinPage does. RC_PIN_PENDING: the read is queued, or joined one in flight, and pollPinCompletions will call
+// callback(bm, page, rc, ctx) once the page is pinned into page or failed with rc. page must stay valid until then
+RC pinPageAsync (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, BM_PinCallback callback, void *ctx)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    SM_FileHandle *fh = &info->files[0].fh;
+    AsyncRead *read, *last = NULL;
+    RC rc;
+    if (pageNum < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&info->lock);
+    if (!info->readOnly && findFrame(bm, 0, pageNum) < 0 && pageNum >= fh->totalNumPages)
+        refreshPageCount(fh);
+    if (info->readOnly || findFrame(bm, 0, pageNum) >= 0 || pageNum >= fh->totalNumPages || startAsyncIO(bm) != RC_OK)
+    {
+        rc = pinPageLocked(bm, page, BM_DEFAULT_TENANT, 0, pageNum); // mapped, resident or zeros past the end: nothing to wait for
+        pthread_mutex_unlock(&info->lock);
+        return rc;
+    }
+
+    for (read = info->asyncReads; read != NULL && read->pageNum != pageNum; read = read->next)
+        last = read;
+    if (read == NULL)
+    {
+        read = (AsyncRead *)calloc(1, sizeof(AsyncRead));
+        read->pageNum = pageNum;
+        for (last = info->asyncReads; last != NULL && last->next != NULL; last = last->next)
+            ;
+        if (last != NULL)
+            last->next = read;
+        else
+            info->asyncReads = read;
+        pthread_cond_broadcast(&info->asyncCond);
+    }
+    else
+        info->numAsyncMerged += 1;
+
+    AsyncWaiter *waiter = (AsyncWaiter *)calloc(1, sizeof(AsyncWaiter)), **link;
+    waiter->page = page;
+    waiter->callback = callback;
+    waiter->ctx = ctx;
+    for (link = &read->waiters; *link != NULL; link = &(*link)->next)
+        ;
+    *link = waiter;
+    info->numAsyncPending += 1;
+    pthread_mutex_unlock(&info->lock);
+    return RC_PIN_PENDING;
+}
+
+
+// Run the callbacks of up to maxCompletions finished requests (all of them for 0) on this thread. With wait set,
+// block until at least one request finishes if none has and some are pending
+RC pollPinCompletions (BM_BufferPool *const bm, const int maxCompletions, const bool wait, int *numCompleted)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    AsyncWaiter *done = NULL, **tail = &done;
+    int count = 0;
+    uint64_t value;
+    pthread_mutex_lock(&info->lock);
+    while (wait && info->completions == NULL && info->numAsyncPending > 0)
+        pthread_cond_wait(&info->asyncCond, &info->lock);
+    while (info->completions != NULL && (maxCompletions <= 0 || count < maxCompletions))
+    {
+        *tail = info->completions;
+        info->completions = info->completions->next;
+        tail = &(*tail)->next;
+        count++;
+    }
+    *tail = NULL;
+    if (info->completions == NULL)
+    {
+        info->lastCompletion = NULL;
+        if (info->completionFd >= 0 && read(info->completionFd, &value, sizeof(value)) < 0)
+            ; // nothing was signalled
+    }
+    info->numAsyncPending -= count;
+    pthread_mutex_unlock(&info->lock);
+
+    *numCompleted = count;
+    while (done != NULL) // outside the lock, callbacks may pin and unpin pages themselves
+    {
+        AsyncWaiter *waiter = done;
+        done = done->next;
+        if (waiter->callback != NULL)
+            waiter->callback(bm, waiter->page, waiter->rc, waiter->ctx);
+        free(waiter);
+    }
+    return RC_OK;
+}
+
+
+// File descriptor that is readable while completions wait for pollPinCompletions, for poll/epoll based event loops
+int getPinCompletionFd (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    if (!info->readOnly)
+        startAsyncIO(bm);
+    int fd = info->completionFd;
+    pthread_mutex_unlock(&info->lock);
+    return fd;
+}
+
+
+// Requests of pinPageAsync not passed to their callback yet
+int getNumPendingPins (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int pending = info->numAsyncPending;
+    pthread_mutex_unlock(&info->lock);
+    return pending;
+}
+
+
+// Requests of pinPageAsync that found a read of their page in flight and shared it
+int getNumMergedPins (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int merged = info->numAsyncMerged;
+    pthread_mutex_unlock(&info->lock);
+    return merged;
+}
+
+
+// Latch of the frame holding a pinned page; the pin keeps the page in that frame's latch
+static FrameLatch *pageLatch(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    FrameLatch *latch = NULL;
+    pthread_mutex_lock(&info->lock);
+    int i = findFrame(bm, page->fileId, page->pageNum);
+    if (i >= 0 && info->frames[i].fixCount > 0)
+        latch = info->frames[i].latch;
+    pthread_mutex_unlock(&info->lock);
+    return latch;
+}
+
+
+// With latch->mutex held
+static bool latchFree(FrameLatch *latch, const BM_LatchMode mode)
+{
+    if (mode == BM_LATCH_SHARED)
+        return !latch->writer && !latch->upgrading && latch->waitingWriters == 0;
+    return !latch->writer && !latch->upgrading && latch->readers == 0;
+}
+
+
+static void recordLatchWait(BM_BufferPool *const bm, const struct timespec *start)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    __atomic_fetch_add(&info->numLatchWaits, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&info->latchWaitMicros, (end.tv_sec - start->tv_sec) * 1000000L + (end.tv_nsec - start->tv_nsec) / 1000, __ATOMIC_RELAXED);
+}
+
+
+static RC acquireLatch(BM_BufferPool *const bm, FrameLatch *latch, const BM_LatchMode mode, const bool wait)
+{
+    struct timespec start;
+    pthread_mutex_lock(&latch->mutex);
+    if (!latchFree(latch, mode))
+    {
+        if (!wait)
+        {
+            pthread_mutex_unlock(&latch->mutex);
+            return RC_LATCH_BUSY;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (mode == BM_LATCH_EXCLUSIVE)
+            latch->waitingWriters += 1;
+        while (!latchFree(latch, mode))
+            pthread_cond_wait(&latch->cond, &latch->mutex);
+        if (mode == BM_LATCH_EXCLUSIVE)
+            latch->waitingWriters -= 1;
+        recordLatchWait(bm, &start);
+    }
+    if (mode == BM_LATCH_SHARED)
+        latch->readers += 1;
+    else
+    {
+        latch->writer = true;
+        lockVersion(latch); // the writer may change the page from here on
+    }
+    pthread_mutex_unlock(&latch->mutex);
+    return RC_OK;
+}
+
+
+static RC pinPageLatchedMode(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_LatchMode mode, const bool wait)
+{
+    if (mode != BM_LATCH_SHARED && mode != BM_LATCH_EXCLUSIVE)
+        return RC_ERROR;
+    RC rc = pinPage(bm, page, pageNum);
+    if (rc != RC_OK)
+        return rc;
+    rc = acquireLatch(bm, pageLatch(bm, page), mode, wait); // without the pool lock, other pages stay available
+    if (rc != RC_OK)
+        unpinPage(bm, page);
+    return rc;
+}
+
+
+// Pin a page and latch it: shared for readers, exclusive for writers of the page
+RC pinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_LatchMode mode)
+{
+    return pinPageLatchedMode(bm, page, pageNum, mode, true);
+}
+
+
+// Like pinPageLatched, but RC_LATCH_BUSY instead of waiting when the latch is held in a conflicting mode; the page is not left pinned then
+RC tryPinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_LatchMode mode)
+{
+    return pinPageLatchedMode(bm, page, pageNum, mode, false);
+}
+
+
+// Turn a shared latch into an exclusive one once the other readers are gone. Only one holder can wait for that:
+// a second one gets RC_LATCH_BUSY, as the two would wait for each other, and should release its latch and start over
+RC upgradeLatch (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    FrameLatch *latch = pageLatch(bm, page);
+    struct timespec start;
+    if (latch == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&latch->mutex);
+    if (latch->readers == 0 || latch->upgrading)
+    {
+        pthread_mutex_unlock(&latch->mutex);
+        return (latch->readers == 0) ? RC_ERROR : RC_LATCH_BUSY;
+    }
+    if (latch->readers > 1)
+    {
+        latch->upgrading = true;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (latch->readers > 1)
+            pthread_cond_wait(&latch->cond, &latch->mutex);
+        latch->upgrading = false;
+        recordLatchWait(bm, &start);
+    }
+    latch->readers = 0;
+    latch->writer = true;
+    lockVersion(latch);
+    pthread_mutex_unlock(&latch->mutex);
+    return RC_OK;
+}
+
+
+// Let readers in again while keeping the page latched
+RC downgradeLatch (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    FrameLatch *latch = pageLatch(bm, page);
+    if (latch == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&latch->mutex);
+    if (!latch->writer)
+    {
+        pthread_mutex_unlock(&latch->mutex);
+        return RC_ERROR;
+    }
+    latch->writer = false;
+    latch->readers = 1;
+    unlockVersion(latch);
+    pthread_cond_broadcast(&latch->cond);
+    pthread_mutex_unlock(&latch->mutex);
+    return RC_OK;
+}
+
+
+// Release the latch taken in mode, then the pin
+RC unpinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const BM_LatchMode mode)
+{
+    FrameLatch *latch = pageLatch(bm, page);
+    if (latch == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&latch->mutex);
+    if (mode == BM_LATCH_SHARED && latch->readers > 0)
+        latch->readers -= 1;
+    else if (mode == BM_LATCH_EXCLUSIVE && latch->writer)
+    {
+        latch->writer = false;
+        unlockVersion(latch); // optimistic reads that overlapped with the writer fail their validation
+    }
+    else
+    {
+        pthread_mutex_unlock(&latch->mutex);
+        return RC_ERROR; // not held in that mode
+    }
+    pthread_cond_broadcast(&latch->cond);
+    pthread_mutex_unlock(&latch->mutex);
+    return unpinPage(bm, page);
+}
+
+
+// Find a resident page for optimistic reads: no pin and no latch is taken, the page stays evictable. RC_LATCH_BUSY
+// while a writer holds it, RC_READ_NON_EXISTING_PAGE if it is not in the pool; pin it then, or look up again later
+RC lookupPageOptimistic (BM_BufferPool *const bm, const PageNumber pageNum, BM_OptimisticRead *read)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int i = findFrame(bm, 0, pageNum);
+    read->frame = (i >= 0) ? info->frames[i].latch : NULL;
+    pthread_mutex_unlock(&info->lock);
+    read->pageNum = pageNum;
+    read->fileId = 0;
+    read->data = NULL;
+    read->version = 0;
+    if (read->frame == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+    return beginOptimisticRead(read);
+}
+
+
+// Start a read, or the next one, of a page found by lookupPageOptimistic, without the pool lock. read->data
+// is where the page is until the frame changes; copy what is needed from it and then validate
+RC beginOptimisticRead (BM_OptimisticRead *read)
+{
+    FrameLatch *latch = (FrameLatch *)read->frame;
+    unsigned long version = __atomic_load_n(&latch->version, __ATOMIC_ACQUIRE);
+    if (version & 1)
+        return RC_LATCH_BUSY;
+    PageNumber pageNum = __atomic_load_n(&latch->pageNum, __ATOMIC_RELAXED);
+    int fileId = __atomic_load_n(&latch->fileId, __ATOMIC_RELAXED);
+    char *data = __atomic_load_n(&latch->data, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&latch->version, __ATOMIC_RELAXED) != version)
+        return RC_LATCH_BUSY; // the frame changed while its page was looked at
+    if (pageNum != read->pageNum || fileId != read->fileId)
+        return RC_READ_NON_EXISTING_PAGE; // evicted, the frame holds another page or none
+    read->data = data;
+    read->version = version;
+    return RC_OK;
+}
+
+
+// True if nothing wrote to the page, or replaced it, since beginOptimisticRead: what was read from read->data holds.
+// Otherwise throw it away and begin again
+bool validateOptimisticRead (BM_OptimisticRead *read)
+{
+    FrameLatch *latch = (FrameLatch *)read->frame;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE); // the reads of the page come before the check
+    return __atomic_load_n(&latch->version, __ATOMIC_RELAXED) == read->version;
+}
+
+
+// Hotness of a frame for the warm list, by the bookkeeping of the pool's strategy
+static int frameHotness(BM_BufferPool *const bm, const int index)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    switch (bm->strategy)
+    {
+        case RS_LRU:
+        case RS_LFU:
+            return pool[index].score;
+        case RS_CLOCK:
+            return pool[index].ref_bit;
+        default: // FIFO: the frame after frameptr is the oldest
+            return (index - ((PoolInfo *)bm->mgmtData)->frameptr - 1 + bm->numPages) % bm->numPages;
+    }
+}
+
+
+static char *warmListName(BM_BufferPool *const bm, const char *suffix)
+{
+    char *name = (char *)malloc(strlen(bm->pageFile) + strlen(WARM_LIST_SUFFIX) + strlen(suffix) + 1);
+    sprintf(name, "%s%s%s", bm->pageFile, WARM_LIST_SUFFIX, suffix);
+    return name;
+}
+
+
+// Write the resident pages, hottest first, next to the page file; a crash mid-save leaves the old list
+RC saveWarmList(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    PageNumber *pages = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages);
+    int *hotness = (int *)malloc(sizeof(int) * bm->numPages);
+    int i, j, count = 0;
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE || pool[i].page.fileId != 0) // the list is kept for the pool's own file
+            continue;
+        int hot = frameHotness(bm, i);
+        for (j = count; j > 0 && hotness[j - 1] < hot; j--) // insertion sort, hottest first
+        {
+            pages[j] = pages[j - 1];
+            hotness[j] = hotness[j - 1];
+        }
+        pages[j] = pool[i].page.pageNum;
+        hotness[j] = hot;
+        count++;
+    }
+    pthread_mutex_unlock(&info->lock);
+
+    char *name = warmListName(bm, "");
+    char *tmpName = warmListName(bm, ".tmp");
+    FILE *fp = fopen(tmpName, "w");
+    if (fp == NULL)
+        rc = RC_WRITE_FAILED;
+    else
+    {
+        unsigned int magic = WARM_LIST_MAGIC;
+        bool written = fwrite(&magic, sizeof(magic), 1, fp) == 1 && fwrite(&count, sizeof(count), 1, fp) == 1
+                && (count == 0 || fwrite(pages, sizeof(PageNumber), count, fp) == (size_t)count);
+        if (fclose(fp) != 0 || !written || rename(tmpName, name) != 0)
+        {
+            remove(tmpName);
+            rc = RC_WRITE_FAILED;
+        }
+    }
+    free(name);
+    free(tmpName);
+    free(pages);
+    free(hotness);
+    return rc;
+}
+
+
+static void *warmListTimer(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->warmLock);
+    while (!info->warmStop)
+    {
+        struct timespec due;
+        clock_gettime(CLOCK_REALTIME, &due);
+        due.tv_sec += info->warmInterval / 1000;
+        due.tv_nsec += (long)(info->warmInterval % 1000) * 1000000;
+        if (due.tv_nsec >= 1000000000)
+        {
+            due.tv_sec += 1;
+            due.tv_nsec -= 1000000000;
+        }
+        if (pthread_cond_timedwait(&info->warmCond, &info->warmLock, &due) == ETIMEDOUT && !info->warmStop)
+        {
+            pthread_mutex_unlock(&info->warmLock);
+            saveWarmList(bm);
+            pthread_mutex_lock(&info->warmLock);
+        }
+    }
+    pthread_mutex_unlock(&info->warmLock);
+    return NULL;
+}
+
+
+// Save the warm list at shutdown, and every saveIntervalMillis from a timer thread if that is positive
+RC enableWarmList(BM_BufferPool *const bm, const int saveIntervalMillis)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    info->warmSave = true;
+    if (saveIntervalMillis <= 0 || info->warmTimerRunning)
+        return RC_OK;
+    info->warmInterval = saveIntervalMillis;
+    info->warmStop = false;
+    if (pthread_create(&info->warmTimer, NULL, warmListTimer, bm) != 0)
+        return RC_ERROR;
+    info->warmTimerRunning = true;
+    return RC_OK;
+}
+
+
+typedef struct WarmUpJob
+{
+    BM_BufferPool *bm;
+    PageNumber *pages; // sorted, split into batches of WARM_BATCH_PAGES
+    SM_PageHandle *data; // what was read for each page, NULL if it couldn't be
+    int numPages;
+    int nextBatch; // taken by the readers with an atomic add
+    int numRead; // pages read from the page file
+} WarmUpJob;
+
+
+// Reader thread: take batches of neighbouring pages until none are left
+static void *warmUpReader(void *arg)
+{
+    WarmUpJob *job = (WarmUpJob *)arg;
+    BM_BufferPool *bm = job->bm;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    SM_FileHandle fh;
+    int numBatches = (job->numPages + WARM_BATCH_PAGES - 1) / WARM_BATCH_PAGES;
+    int batch, i, k, run;
+
+    if (!info->readOnly && openPageFile(bm->pageFile, &fh) != RC_OK)
+        return NULL;
+    while ((batch = __atomic_fetch_add(&job->nextBatch, 1, __ATOMIC_RELAXED)) < numBatches)
+    {
+        int first = batch * WARM_BATCH_PAGES;
+        int last = (first + WARM_BATCH_PAGES < job->numPages) ? first + WARM_BATCH_PAGES : job->numPages;
+        if (info->readOnly) // the kernel reads the batch into the mapping, frames just point at it
+        {
+            adviseBlocks(job->pages[first], job->pages[last - 1] - job->pages[first] + 1, &info->mapped, SM_ADVICE_WILLNEED);
+            continue;
+        }
+        for (i = first; i < last; i = run)
+        {
+            if (job->pages[i] >= fh.totalNumPages)
+                break; // the file shrank since the list was saved, the rest of the batch is past its end too
+            for (run = i + 1; run < last && job->pages[run] == job->pages[run - 1] + 1 && job->pages[run] < fh.totalNumPages; run++)
+                ;
+            for (k = i; k < run; k++)
+                job->data[k] = allocPageBuffer(bm->pageSize);
+            __atomic_fetch_add(&job->numRead, run - i, __ATOMIC_RELAXED);
+            if (readBlocks(job->pages[i], run - i, &fh, &job->data[i]) == RC_OK) // neighbours in one read
+                continue;
+            for (k = i; k < run; k++) // a damaged page spoils the run: read them one by one, leaving out the bad ones
+            {
+                if (readBlock(job->pages[k], &fh, job->data[k]) != RC_OK)
+                {
+                    releasePageBuffer(bm->pageSize, job->data[k]);
+                    job->data[k] = NULL;
+                }
+            }
+        }
+    }
+    if (!info->readOnly)
+        closePageFile(&fh);
+    return NULL;
+}
+
+
+static int comparePageNumbers(const void *a, const void *b)
+{
+    return *(const PageNumber *)a - *(const PageNumber *)b;
+}
+
+
+// Find where page ended up after sorting
+static int sortedIndex(const PageNumber *sorted, const int num, const PageNumber pageNum)
+{
+    PageNumber *found = (PageNumber *)bsearch(&pageNum, sorted, num, sizeof(PageNumber), comparePageNumbers);
+    return (found != NULL) ? found - sorted : -1;
+}
+
+
+static void *warmUpWorker(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    char *name = warmListName(bm, "");
+    FILE *fp = fopen(name, "r");
+    unsigned int magic;
+    int count = 0, i, j;
+    free(name);
+    if (fp == NULL)
+        return NULL;
+    if (fread(&magic, sizeof(magic), 1, fp) != 1 || magic != WARM_LIST_MAGIC || fread(&count, sizeof(count), 1, fp) != 1 || count < 0)
+        count = 0;
+    if (count > bm->numPages)
+        count = bm->numPages; // the hottest pages that fit
+    PageNumber *hottest = (PageNumber *)malloc(sizeof(PageNumber) * (count + 1));
+    if (count > 0 && fread(hottest, sizeof(PageNumber), count, fp) != (size_t)count)
+        count = 0;
+    fclose(fp);
+
+    // Read in page order, several batches at a time
+    WarmUpJob job;
+    pthread_t readers[WARM_THREADS];
+    job.bm = bm;
+    job.pages = (PageNumber *)malloc(sizeof(PageNumber) * (count + 1));
+    job.data = (SM_PageHandle *)calloc(count + 1, sizeof(SM_PageHandle));
+    job.nextBatch = 0;
+    job.numRead = 0;
+    for (i = 0, j = 0; i < count; i++)
+    {
+        if (hottest[i] >= 0)
+            job.pages[j++] = hottest[i];
+    }
+    qsort(job.pages, j, sizeof(PageNumber), comparePageNumbers);
+    for (i = 0, job.numPages = 0; i < j; i++) // drop duplicates of a damaged list
+    {
+        if (job.numPages == 0 || job.pages[job.numPages - 1] != job.pages[i])
+            job.pages[job.numPages++] = job.pages[i];
+    }
+    int numReaders = (job.numPages + WARM_BATCH_PAGES - 1) / WARM_BATCH_PAGES;
+    if (numReaders > WARM_THREADS)
+        numReaders = WARM_THREADS;
+    for (i = 0; i < numReaders; i++)
+    {
+        if (pthread_create(&readers[i], NULL, warmUpReader, &job) != 0)
+            break;
+    }
+    if (i == 0 && numReaders > 0)
+        warmUpReader(&job);
+    for (j = 0; j < i; j++)
+        pthread_join(readers[j], NULL);
+    pthread_mutex_lock(&info->lock);
+    info->numReadIO += job.numRead;
+    pthread_mutex_unlock(&info->lock);
+
+    // Install coldest first, so the hottest page ends up most recently used; frames in use by now are left alone
+    BM_PageHandle h;
+    for (i = count - 1; i >= 0; i--)
+    {
+        int k = sortedIndex(job.pages, job.numPages, hottest[i]);
+        if (k < 0 || (!info->readOnly && job.data[k] == NULL))
+            continue;
+        pthread_mutex_lock(&info->lock);
+        bool resident = false, space = false;
+        for (j = 0; j < bm->numPages; j++)
+        {
+            resident = resident || (info->frames[j].page.pageNum == hottest[i] && info->frames[j].page.fileId == 0);
+            space = space || info->frames[j].page.pageNum == NO_PAGE;
+        }
+        if (!resident && space)
+        {
+            info->preloadPage = hottest[i];
+            info->preloadData = job.data[k];
+            if (pinPageLocked(bm, &h, BM_DEFAULT_TENANT, 0, hottest[i]) == RC_OK)
+            {
+                unpinPage(bm, &h);
+                info->numWarmed += 1;
+            }
+            info->preloadPage = NO_PAGE;
+            if (info->preloadData == NULL)
+                job.data[k] = NULL; // taken by the frame
+            info->preloadData = NULL;
+        }
+        pthread_mutex_unlock(&info->lock);
+    }
+    for (i = 0; i < job.numPages; i++)
+    {
+        if (!info->readOnly && job.data[i] != NULL)
+            releasePageBuffer(bm->pageSize, job.data[i]);
+    }
+    free(job.pages);
+    free(job.data);
+    free(hottest);
+    return NULL;
+}
+
+
+// Preload the pages of the saved warm list, now or from a background thread while the pool serves pins
+RC warmUpBufferPool(BM_BufferPool *const bm, const bool background)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    char *name = warmListName(bm, "");
+    FILE *fp = fopen(name, "r");
+    free(name);
+    if (fp == NULL)
+        return RC_FILE_NOT_FOUND;
+    fclose(fp);
+    if (info->warmUpRunning)
+        return RC_OK;
+    if (!background)
+    {
+        warmUpWorker(bm);
+        return RC_OK;
+    }
+    if (pthread_create(&info->warmUpThread, NULL, warmUpWorker, bm) != 0)
+        return RC_ERROR;
+    info->warmUpRunning = true;
+    return RC_OK;
+}
+
+
+RC waitForWarmUp(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->warmUpRunning)
+    {
+        pthread_join(info->warmUpThread, NULL);
+        info->warmUpRunning = false;
+    }
+    return RC_OK;
+}
+
+
+// Reset a frame to hold no page, its write count stays with the frame
+static void clearFrame(PageFrames *frame)
+{
+    frame->page.pageNum = NO_PAGE;
+    frame->page.data = NULL;
+    frame->page.fileId = 0;
+    frame->is_Dirty = false;
+    frame->is_pinned = false;
+    frame->fixCount = 0;
+    frame->score = 0;
+    frame->ref_bit = 0;
+    frame->pageLSN = NO_LSN;
+    frame->recLSN = NO_LSN;
+    frame->hint = BM_HINT_NORMAL;
+    frame->sticky = false;
+    frame->tenant = BM_DEFAULT_TENANT;
+}
+
+
+// Give the resident LRU frames the scores they would have after being loaded into a pool of this size
+static void renumberLRUScores(BM_BufferPool *const bm)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int *order = (int *)malloc(sizeof(int) * bm->numPages);
+    int i, j, count = 0;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].page.pageNum == NO_PAGE)
+            continue;
+        for (j = count; j > 0 && pool[order[j - 1]].score > pool[i].score; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+        count++;
+    }
+    for (j = 0; j < count; j++)
+        pool[order[j]].score = bm->numPages - count + j;
+    free(order);
+}
+
+
+// Change the number of frames while the pool stays in use. Shrinking evicts the coldest unpinned pages
+// and moves the others, pinned ones included, into the frames that remain
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool;
+    int i, j, hand = -1, resident = 0, unpinned = 0;
+    if (newNumPages <= 0)
+        return RC_ERROR;
+
+    pthread_mutex_lock(&info->lock);
+    pool = info->frames;
+    if (newNumPages < bm->numPages)
+    {
+        for (i = 0; i < bm->numPages; i++)
+        {
+            if (pool[i].page.pageNum != NO_PAGE)
+            {
+                resident++;
+                if (pool[i].fixCount == 0)
+                    unpinned++;
+            }
+        }
+        if (resident - newNumPages > unpinned)
+        {
+            pthread_mutex_unlock(&info->lock);
+            return RC_BUFFER_IN_USE_BY_CLIENT; // pinned pages alone would not fit
+        }
+        for (; resident > newNumPages; resident--)
+        {
+            int victim = -1;
+            for (i = 0; i < bm->numPages; i++)
+            {
+                if (pool[i].page.pageNum != NO_PAGE && pool[i].fixCount == 0
+                        && (victim < 0 || frameHotness(bm, i) < frameHotness(bm, victim)))
+                    victim = i;
+            }
+            RC rc = evictFrame(bm, victim);
+            if (rc != RC_OK) // the pool keeps its size, the pages evicted so far leave free frames
+            {
+                if (bm->strategy == RS_LRU)
+                    renumberLRUScores(bm);
+                rebuildFrameIndex(bm);
+                pthread_mutex_unlock(&info->lock);
+                return rc;
+            }
+            clearFrame(&pool[victim]);
+        }
+        for (i = 0, j = 0; i < bm->numPages; i++) // swap, so the frames dropped are empty ones
+        {
+            if (pool[i].page.pageNum != NO_PAGE)
+            {
+                PageFrames tmp = pool[j];
+                pool[j] = pool[i];
+                pool[i] = tmp;
+                if (i != j && info->policy->onMove != NULL)
+                    info->policy->onMove(bm, info->policy->data, i, j); // a policy keeping per-frame state follows the page
+                if (i <= info->frameptr)
+                    hand = j;
+                j++;
+            }
+        }
+        // The hand goes to the page it was on, or the last one before it: FIFO and Clock go round in the same order
+        info->frameptr = (hand >= 0) ? hand : (j > 0) ? j - 1 : 0;
+        for (i = newNumPages; i < bm->numPages; i++)
+        {
+            info->retiredWrites += pool[i].writeCount;
+            pool[i].latch->nextRetired = info->retiredLatches; // no holders, as there is no page to pin, but optimistic readers may still check it
+            info->retiredLatches = pool[i].latch;
+        }
+        info->frames = (PageFrames *)realloc(pool, sizeof(PageFrames) * newNumPages);
+    }
+    else if (newNumPages > bm->numPages)
+    {
+        info->frames = (PageFrames *)realloc(pool, sizeof(PageFrames) * newNumPages);
+        for (i = bm->numPages; i < newNumPages; i++)
+        {
+            clearFrame(&info->frames[i]);
+            info->frames[i].writeCount = 0;
+            info->frames[i].latch = createLatch();
+        }
+    }
+    bm->numPages = newNumPages;
+    // Same share of free frames as before: a high watermark left past a shrunk pool would have the evictor empty it
+    info->lowWatermark = info->lowWatermarkSet * newNumPages / info->watermarkFrames;
+    info->highWatermark = info->highWatermarkSet * newNumPages / info->watermarkFrames;
+    if (bm->strategy == RS_LRU)
+        renumberLRUScores(bm);
+    rebuildFrameIndex(bm);
+    if (info->evictorRunning && info->numFree < info->lowWatermark)
+        pthread_cond_signal(&info->evictCond);
+    if (info->numPinWaiters > 0)
+        pthread_cond_broadcast(&info->unpinCond); // new frames are free
+
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Evict the page of an unpinned frame and leave the frame free; with the lock held
+static RC dropFrame(BM_BufferPool *const bm, const int index)
+{
+    RC rc = evictFrame(bm, index);
+    if (rc != RC_OK)
+        return rc; // the frame keeps its dirty page
+    clearFrame(&((PoolInfo *)bm->mgmtData)->frames[index]);
+    setFrameFree(bm, index, true);
+    if (bm->strategy == RS_LRU)
+        renumberLRUScores(bm); // LRU looks for score 0 among the frames that hold pages
+    return RC_OK;
+}
+
+
+// Evict the coldest unpinned pages, by the same measure a shrinking resize uses, until highWatermark frames are free.
+// A dirty page is written back with the pool lock held, like any eviction; the lock is let go between pages, so pins
+// get in between evictions, and misses find free frames instead of writing back themselves
+static void *backgroundEvictor(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    bool refilling = false;
+    pthread_mutex_lock(&info->lock);
+    while (!info->evictStop)
+    {
+        int victim = -1;
+        if (info->numFree < info->lowWatermark)
+            refilling = true;
+        else if (info->numFree >= info->highWatermark)
+            refilling = false;
+        if (refilling)
+        {
+            for (i = 0; i < bm->numPages; i++)
+            {
+                if (info->frames[i].page.pageNum != NO_PAGE && info->frames[i].fixCount == 0 && !info->frames[i].is_pinned
+                        && !info->frames[i].sticky && (victim < 0 || frameHotness(bm, i) < frameHotness(bm, victim)))
+                    victim = i;
+            }
+        }
+        if (victim < 0)
+        {
+            refilling = false;
+            pthread_cond_wait(&info->evictCond, &info->lock); // enough is free, or everything left is pinned
+            continue;
+        }
+        if (dropFrame(bm, victim) != RC_OK)
+        {
+            refilling = false;
+            pthread_cond_wait(&info->evictCond, &info->lock); // the page stays dirty; try again when signalled
+            continue;
+        }
+        info->numBackgroundEvictions += 1;
+        pthread_mutex_unlock(&info->lock);
+        sched_yield();
+        pthread_mutex_lock(&info->lock);
+    }
+    pthread_mutex_unlock(&info->lock);
+    return NULL;
+}
+
+
+static void startEvictor(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (info->evictorRunning || info->highWatermark == 0)
+        return;
+    info->evictStop = false;
+    if (pthread_create(&info->evictor, NULL, backgroundEvictor, bm) == 0)
+        info->evictorRunning = true;
+}
+
+
+static void stopEvictor(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (!info->evictorRunning)
+        return;
+    pthread_mutex_lock(&info->lock);
+    info->evictStop = true;
+    pthread_cond_signal(&info->evictCond);
+    pthread_mutex_unlock(&info->lock);
+    pthread_join(info->evictor, NULL);
+    info->evictorRunning = false;
+}
+
+
+// Keep between lowWatermark and highWatermark frames free from a background thread, so misses take a free frame
+// instead of running the replacement strategy; 0 and 0 stop the thread. Misses still evict inline if none is free.
+// resizeBufferPool scales both to the new number of frames
+RC setFreeFrameWatermarks(BM_BufferPool *const bm, const int lowWatermark, const int highWatermark)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (lowWatermark < 0 || highWatermark < lowWatermark || highWatermark > bm->numPages)
+        return RC_ERROR;
+    stopEvictor(bm);
+    pthread_mutex_lock(&info->lock);
+    info->lowWatermark = info->lowWatermarkSet = lowWatermark;
+    info->highWatermark = info->highWatermarkSet = highWatermark;
+    info->watermarkFrames = bm->numPages;
+    pthread_mutex_unlock(&info->lock);
+    startEvictor(bm);
+    return RC_OK;
+}
+
+
+int getNumFreeFrames(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int numFree = info->numFree;
+    pthread_mutex_unlock(&info->lock);
+    return numFree;
+}
+
+
+int getNumBackgroundEvictions(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int num = info->numBackgroundEvictions;
+    pthread_mutex_unlock(&info->lock);
+    return num;
+}
+
+
+// How long a pin waits for a frame to be unpinned when all are pinned before it fails with RC_ALL_FRAMES_PINNED; 0 fails at once
+RC setPinWaitTimeout(BM_BufferPool *const bm, const int millis)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (millis < 0)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    info->pinWaitMillis = millis;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+int getNumPinWaits(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int num = info->numPinWaits;
+    pthread_mutex_unlock(&info->lock);
+    return num;
+}
+
+
+long getPinWaitMicros(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    long micros = info->pinWaitMicros;
+    pthread_mutex_unlock(&info->lock);
+    return micros;
+}
+
+
+int getNumPinTimeouts(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int num = info->numPinTimeouts;
+    pthread_mutex_unlock(&info->lock);
+    return num;
+}
+
+
+// Share of the frames the sticky set may take, DEFAULT_STICKY_PERCENT until set; pages already sticky stay so
+RC setStickyLimit(BM_BufferPool *const bm, const int maxPercent)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (maxPercent < 0 || maxPercent > 100)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    info->stickyPercent = maxPercent;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+// Add a page to the sticky set or take it out, resident or not; RC_STICKY_LIMIT when the set is full
+RC setPageSticky(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum, const bool sticky)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int k, index;
+    RC rc = RC_OK;
+    if (pageNum < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&info->lock);
+    if (fileId < 0 || fileId >= info->numFiles)
+    {
+        pthread_mutex_unlock(&info->lock);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    k = stickyIndex(bm, fileId, pageNum);
+    if (sticky && k < 0)
+    {
+        if ((info->numSticky + 1) * 100 > bm->numPages * info->stickyPercent)
+            rc = RC_STICKY_LIMIT;
+        else
+        {
+            if (info->numSticky == info->stickyCapacity)
+            {
+                info->stickyCapacity = (info->stickyCapacity == 0) ? 8 : 2 * info->stickyCapacity;
+                info->stickyPages = (PageNumber *)realloc(info->stickyPages, sizeof(PageNumber) * info->stickyCapacity);
+                info->stickyFiles = (int *)realloc(info->stickyFiles, sizeof(int) * info->stickyCapacity);
+            }
+            info->stickyPages[info->numSticky] = pageNum;
+            info->stickyFiles[info->numSticky] = fileId;
+            info->numSticky += 1;
+            info->hintsUsed = true;
+        }
+    }
+    else if (!sticky && k >= 0) // the last one takes its place
+    {
+        info->numSticky -= 1;
+        info->stickyPages[k] = info->stickyPages[info->numSticky];
+        info->stickyFiles[k] = info->stickyFiles[info->numSticky];
+    }
+    if (rc == RC_OK && (index = findFrame(bm, fileId, pageNum)) >= 0)
+        info->frames[index].sticky = sticky;
+    pthread_mutex_unlock(&info->lock);
+    return rc;
+}
+
+
+int getNumStickyPages(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int num = info->numSticky;
+    pthread_mutex_unlock(&info->lock);
+    return num;
+}
+
+
+// Prefer clean victims within the coldest maxPercent of the frames (0 turns it off); adaptive narrows the
+// window from the read and write times the pool measures
+RC setCleanFirstWindow(BM_BufferPool *const bm, const int maxPercent, const bool adaptive)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (maxPercent < 0 || maxPercent > 100)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    info->cleanFirstMaxPercent = maxPercent;
+    info->cleanFirstAdaptive = adaptive;
+    info->cleanFirstPercent = maxPercent;
+    adaptCleanFirstWindow(bm);
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+int getCleanFirstWindow(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int percent = info->cleanFirstPercent;
+    pthread_mutex_unlock(&info->lock);
+    return percent;
+}
+
+
+int getNumCleanFirstEvictions(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    int num = info->numCleanFirstEvictions;
+    pthread_mutex_unlock(&info->lock);
+    return num;
+}
+
+
+// Hits the pool would gain with numFrames more frames, and lose with numFrames fewer, since the last reset
+RC getMarginalHits(BM_BufferPool *const bm, const int numFrames, int *gain, int *loss)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    *gain = 0;
+    *loss = 0;
+    pthread_mutex_lock(&info->lock);
+    for (i = 0; i < numFrames && i < GHOST_PAGES; i++)
+    {
+        *gain += info->ghostHits[i];
+        *loss += info->coldHits[i];
+    }
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+static void resetMarginalHits(BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    memset(info->ghostHits, 0, sizeof(info->ghostHits));
+    memset(info->coldHits, 0, sizeof(info->coldHits));
+    pthread_mutex_unlock(&info->lock);
+}
+
+
+BM_MemoryBroker *createMemoryBroker(const int framesPerMove, const int minPagesPerPool)
+{
+    BM_MemoryBroker *broker = (BM_MemoryBroker *)calloc(1, sizeof(BM_MemoryBroker));
+    broker->framesPerMove = (framesPerMove < GHOST_PAGES) ? framesPerMove : GHOST_PAGES;
+    broker->minPagesPerPool = minPagesPerPool;
+    return broker;
+}
+
+
+RC brokerAddPool(BM_MemoryBroker *broker, BM_BufferPool *const bm)
+{
+    if (broker->numPools == MAX_BROKER_POOLS)
+        return RC_ERROR;
+    broker->pools[broker->numPools++] = bm;
+    resetMarginalHits(bm);
+    return RC_OK;
+}
+
+
+// Move framesPerMove frames from the pool that would lose the fewest hits to the one that would gain the most,
+// when that is a gain; the statistics start over either way
+RC rebalanceMemory(BM_MemoryBroker *broker, int *framesMoved)
+{
+    int i, gain, loss;
+    int taker = -1, giver = -1, bestGain = 0, leastLoss = 0;
+    *framesMoved = 0;
+    for (i = 0; i < broker->numPools; i++)
+    {
+        getMarginalHits(broker->pools[i], broker->framesPerMove, &gain, &loss);
+        if (taker < 0 || gain > bestGain)
+        {
+            taker = i;
+            bestGain = gain;
+        }
+    }
+    for (i = 0; i < broker->numPools; i++)
+    {
+        getMarginalHits(broker->pools[i], broker->framesPerMove, &gain, &loss);
+        if (i != taker && broker->pools[i]->numPages - broker->framesPerMove >= broker->minPagesPerPool
+                && (giver < 0 || loss < leastLoss))
+        {
+            giver = i;
+            leastLoss = loss;
+        }
+    }
+
+    RC rc = RC_OK;
+    if (taker >= 0 && giver >= 0 && taker != giver && bestGain > leastLoss)
+    {
+        BM_BufferPool *from = broker->pools[giver];
+        BM_BufferPool *to = broker->pools[taker];
+        rc = resizeBufferPool(from, from->numPages - broker->framesPerMove);
+        if (rc == RC_OK)
+            rc = resizeBufferPool(to, to->numPages + broker->framesPerMove);
+        if (rc == RC_OK)
+            *framesMoved = broker->framesPerMove;
+    }
+    for (i = 0; i < broker->numPools; i++)
+        resetMarginalHits(broker->pools[i]);
+    return rc;
+}
+
+
+void destroyMemoryBroker(BM_MemoryBroker *broker)
+{
+    free(broker); // the pools belong to the caller
+}
+
+
+PageNumber *getFrameContents (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    pthread_mutex_lock(&info->lock);
+    PageNumber *PageNumbers = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages); // declare a PageNumber type array of size = number of frames in bufferpool
+    memcpy(PageNumbers, info->framePages, sizeof(PageNumber) * bm->numPages);
+    pthread_mutex_unlock(&info->lock);
+    return PageNumbers;
+}
+
+
+bool *getDirtyFlags (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    pthread_mutex_lock(&info->lock);
+    bool *DirtyFlags = (bool *)malloc(sizeof(bool) * bm->numPages); // declare a boolean array of size = number of frames in buffer
+    for (i = 0; i < bm->numPages; i++)
+    {
+        DirtyFlags[i] = info->frames[i].is_Dirty;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return DirtyFlags;
+}
+
+
+int *getFixCounts (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    pthread_mutex_lock(&info->lock);
+    int *FixCounts = (int *)malloc(sizeof(int) * bm->numPages); // declare a integer array of size = number of frames in buffer
+    for (i = 0; i < bm->numPages; i++)
+    {
+        FixCounts[i] = info->frames[i].fixCount;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return FixCounts;
+}
+
+
+// File of the page in each frame, NO_PAGE for empty frames
+int *getFrameFileIds (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int i;
+    pthread_mutex_lock(&info->lock);
+    int *FileIds = (int *)malloc(sizeof(int) * bm->numPages);
+    for (i = 0; i < bm->numPages; i++)
+    {
+        FileIds[i] = (info->framePages[i] != NO_PAGE) ? info->frameFiles[i] : NO_PAGE;
+    }
+    pthread_mutex_unlock(&info->lock);
+    return FileIds;
+}
+
+
+int getNumReadIO (BM_BufferPool *const bm)
+{
+    return ((PoolInfo *)bm->mgmtData)->numReadIO;  // counted as pages are read in
+}
+
+
+int getNumTierHits (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    return (info->tier != NULL) ? info->tier->hits : 0;
+}
+
+
+int getNumL2Hits (BM_BufferPool *const bm)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    return (info->l2 != NULL) ? info->l2->hits : 0;
+}
+
+
+int getNumWarmedPages (BM_BufferPool *const bm)
+{
+    return ((PoolInfo *)bm->mgmtData)->numWarmed;
+}
+
+
+// Latch requests that had to wait, and the microseconds they waited in total
+int getNumLatchWaits (BM_BufferPool *const bm)
+{
+    return (int)__atomic_load_n(&((PoolInfo *)bm->mgmtData)->numLatchWaits, __ATOMIC_RELAXED);
+}
+
+
+// Frames charged to a tenant and its pins that hit and missed, since the pool started
+RC getTenantStats (BM_BufferPool *const bm, const int tenantId, int *numFrames, int *numHits, int *numMisses)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    int counts[MAX_TENANTS];
+    if (tenantId < 0 || tenantId >= MAX_TENANTS)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    countTenantFrames(bm, counts);
+    *numFrames = counts[tenantId];
+    *numHits = info->tenants[tenantId].numHits;
+    *numMisses = info->tenants[tenantId].numMisses;
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+
+long getLatchWaitMicros (BM_BufferPool *const bm)
+{
+    return __atomic_load_n(&((PoolInfo *)bm->mgmtData)->latchWaitMicros, __ATOMIC_RELAXED);
+}
+
+
+int getNumWriteIO (BM_BufferPool *const bm)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int NumWriteIO = ((PoolInfo *)bm->mgmtData)->retiredWrites;
+    int i;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        NumWriteIO += pool[i].writeCount;  // Add writeCount for each frame
+    }
+
+    return NumWriteIO;
+}
+
+
+// Write back the page in a victim frame if it was modified and recycle its buffer. If the write fails the frame
+// keeps its page and data, still dirty, so the change is not lost
+static RC evictFrame(BM_BufferPool *const bm, const int index)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    assert(pool[index].fixCount == 0 && !pool[index].is_pinned); // clients still hold pointers into a pinned frame's buffer
+    if (pool[index].is_Dirty == true)
+    {
+        RC rc = writeFrame(bm, index); // write page onto the disk
+        if (rc != RC_OK)
+            return rc;
+    }
+    if (pool[index].is_Dirty == false && pool[index].page.pageNum != NO_PAGE && pool[index].page.fileId == 0) // page matches the disk copy now
+    {
+        if (info->tier != NULL)
+            putCompressedPage(info->tier, pool[index].page.pageNum, pool[index].page.data);
+        if (info->l2 != NULL)
+            putL2Page(info->l2, pool[index].page.pageNum, pool[index].page.data);
+    }
+    if (pool[index].page.pageNum != NO_PAGE)
+    {
+        info->ghost[info->ghostHead] = pool[index].page.pageNum;
+        info->ghostFile[info->ghostHead] = pool[index].page.fileId;
+        info->ghostHead = (info->ghostHead + 1) % GHOST_PAGES;
+    }
+    discardFrame(bm, index);
+    return RC_OK;
+}
+
+
+// Empty a frame without writing its page back: the policy is told the page left and the buffer goes back to the arena
+static void discardFrame(BM_BufferPool *const bm, const int index)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    char *data = pool[index].page.data;
+    if (pool[index].page.pageNum != NO_PAGE && info->policy->onEvict != NULL)
+        info->policy->onEvict(bm, info->policy->data, index);
+    pool[index].page.pageNum = NO_PAGE;
+    pool[index].page.data = NULL;
+    frameChanged(bm, index); // optimistic readers of the old page must not trust the buffer from here on
+    if (!info->readOnly && data != NULL)
+        releasePageBuffer(bm->pageSize, data);
+    pool[index].pageLSN = NO_LSN;
+    pool[index].recLSN = NO_LSN;
+}
+
+
+/*
+ * The built-in strategies as replacement policies. Their bookkeeping lives in the frames
+ * (score, ref_bit) and in the pool's frameptr, set up by initBufferPool and setReplacementPolicy;
+ * victims are chosen by the original scans, which all skip pinned frames. pinPageLocked only
+ * asks for a victim when an unpinned frame exists.
+ */
+
+// Move the frame to the top of the LRU order, the frames above it move down by one
+static void lruTouch(BM_BufferPool *const bm, void *data, const int frame)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i, score = pool[frame].score; // the frame's own score drops in the loop too
+    for (i = 0; i < bm->numPages; i++)
+    {
+        if (pool[i].score >= score) // Decrease score of frames which had greater scores
+            pool[i].score -= 1;
+    }
+    pool[frame].score = bm->numPages - 1; // assign highest score as it will be the most recently used frame
+}
+
+
+static int lruVictim(BM_BufferPool *const bm, void *data)
+{
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i, index = -1, replace_score = 0; // score of least recently used frame would be zero
+    bool spaceFound = false;
+    while (!spaceFound)
+    {
+        for (i = 0; i < bm->numPages; i++)
+        {
+            if(pool[i].score == replace_score) // Find frame with least score
+            {
+                if (pool[i].is_pinned == true || pool[i].fixCount > 0) // if page in the frame is in use
+                {
+                    replace_score += 1; // move to next least recently used frame
+                    break;
+                }
+                else
+                {
+                    spaceFound = true; // break for and while loop and store the index of this frame
+                    index = i;
+                    break;
+                }
+            }
+        }
+    }
+    return index;
+}
+
+
+static void clockHit(BM_BufferPool *const bm, void *data, const int frame)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    info->frames[frame].ref_bit = 1; // Set reference bit to 1 (for Clock)
+    info->frameptr += 1; // move pointer to next frame
+    if (info->frameptr >= bm->numPages)
+        info->frameptr = 0;
+}
+
+
+// Clock and FIFO go on from the frame loaded last
+static void ringLoad(BM_BufferPool *const bm, void *data, const int frame)
+{
+    ((PoolInfo *)bm->mgmtData)->frameptr = frame;  // Set Frame pointer to this frame
+}
+
+
+static int clockVictim(BM_BufferPool *const bm, void *data)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    info->frameptr += 1;
+
+    if (info->frameptr >= bm->numPages) // Set frameptr to 0 if it moves past last frame (to move in circle)
+            info->frameptr = 0;
+
+    // reference bit 0 on a frame not in use: frame to be replaced, found. Pinned frames keep their bit
+    while (pool[info->frameptr].fixCount > 0 || pool[info->frameptr].is_pinned || pool[info->frameptr].ref_bit != 0)
+    {
+        if (pool[info->frameptr].fixCount == 0 && !pool[info->frameptr].is_pinned)
+            pool[info->frameptr].ref_bit = 0;
+        info->frameptr += 1;
+        if (info->frameptr >= bm->numPages) // Set frameptr to 0 if it reaches last frame (to move in circle)
+            info->frameptr = 0;
+    }
+    return info->frameptr;
+}
+
+
+static int fifoVictim(BM_BufferPool *const bm, void *data)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    info->frameptr += 1;
+    if (info->frameptr >= bm->numPages)
+        info->frameptr = 0;
+    PageFrames *pool = info->frames;
+    while (pool[info->frameptr].is_pinned == true) // Move to next frame if page is in use
+    {
+        info->frameptr += 1;
+        if (info->frameptr >= bm->numPages)
+            info->frameptr = 0;
+    }
+    return info->frameptr; // Found the Frame where page is to be replaced
+}
+
+
+static void lfuHit(BM_BufferPool *const bm, void *data, const int frame)
+{
+    ((PoolInfo *)bm->mgmtData)->frames[frame].score += 1; // Increase the score if requested page was a hit
+}
+
+
+static void lfuLoad(BM_BufferPool *const bm, void *data, const int frame)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    info->frames[frame].score = 1;
+    info->frameptr = frame;  // Set Frame pointer to this frame
+}
+
+
+// One pass round the frames from the one after the hand: the unpinned frame with the lowest count, the first of
+// equals; -1 if every frame is pinned
+static int lfuVictim(BM_BufferPool *const bm, void *data)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    PageFrames *pool = info->frames;
+    int i, frame, victim = -1;
+    for (i = 1; i <= bm->numPages; i++)
+    {
+        frame = (info->frameptr + i) % bm->numPages;
+        if (pool[frame].fixCount == 0 && !pool[frame].is_pinned && (victim < 0 || pool[frame].score < pool[victim].score))
+            victim = frame;
+    }
+    if (victim >= 0)
+        info->frameptr = victim;
+    return victim;
+}
+
+
+static int noVictim(BM_BufferPool *const bm, void *data)
+{
+    printf("\nAlgorithm Not Implemented\n");
+    return -1;
+}
+
+
+// Indexed by ReplacementStrategy: onHit, onLoad, onUnpin, chooseVictim, onEvict, onMove, data. Their state lives in
+// the frames, which a resize moves along with the pages
+static const BM_ReplacementPolicy builtinPolicies[] = {
+    { NULL, ringLoad, NULL, fifoVictim, NULL, NULL, NULL },  // RS_FIFO
+    { lruTouch, lruTouch, NULL, lruVictim, NULL, NULL, NULL },  // RS_LRU
+    { clockHit, ringLoad, NULL, clockVictim, NULL, NULL, NULL },  // RS_CLOCK
+    { lfuHit, lfuLoad, NULL, lfuVictim, NULL, NULL, NULL },  // RS_LFU
+    { NULL, NULL, NULL, noVictim, NULL, NULL, NULL }  // RS_LRU_K
+};
+
+
+static const BM_ReplacementPolicy *builtinPolicy(const ReplacementStrategy strategy)
+{
+    if (strategy < RS_FIFO || strategy > RS_LRU_K)
+        return &builtinPolicies[RS_LRU_K];
+    return &builtinPolicies[strategy];
+}
+
+
+// Replace the pool's policy from now on; NULL goes back to the built-in one of bm->strategy
+RC setReplacementPolicy(BM_BufferPool *const bm, const BM_ReplacementPolicy *policy)
+{
+    PoolInfo *info = (PoolInfo *)bm->mgmtData;
+    if (policy != NULL && policy->chooseVictim == NULL)
+        return RC_ERROR;
+    pthread_mutex_lock(&info->lock);
+    info->policy = (policy != NULL) ? policy : builtinPolicy(bm->strategy);
+    info->frameptr = 0; // the hand of the policy replaced meant nothing to this one
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+extern void displaycontents(BM_BufferPool *const bm)
+{
+    printf("\n\nBufferpool's information:\n");
+    printf("Number of frames: %d\n",bm->numPages);
+    printf("Page file: %s\n",bm->pageFile);
+    printf("Strategy: %d\n",bm->strategy);
+    printf("Read IO: %d\n",((PoolInfo *)bm->mgmtData)->numReadIO);
+    PageFrames *pool = ((PoolInfo *)bm->mgmtData)->frames;
+    int i;
+    for (i = 0; i < bm->numPages; i++)
+    {
+        printf("\nFrame: %d\n", i);
+        printf("pagenum: %d\n", pool[i].page.pageNum);
+        printf("page content: %s\n",pool[i].page.data);
+        printf("is_dirty: %d\n",pool[i].is_Dirty);
+        printf("is_pinned: %d\n",pool[i].is_pinned);
+        printf("fixCount: %d\n",pool[i].fixCount);
+        printf("writeCount: %d\n",pool[i].writeCount);
+        printf("score: %d\n",pool[i].score);
+        printf("ref_bit: %d\n",pool[i].ref_bit);
+        printf("Frame pointer value %d\n", ((PoolInfo *)bm->mgmtData)->frameptr);
+    }
 }
\ No newline at end of file
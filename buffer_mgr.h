@@ -7,6 +7,13 @@
 // Include bool DT
 #include "dt.h"
 
+// Include LSN and the write-ahead log
+#include "wal_mgr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
@@ -23,6 +30,7 @@ typedef int PageNumber;
 typedef struct BM_BufferPool {
 	char *pageFile;  
 	int numPages;  // number of frames
+	int pageSize;  // page size of pageFile, taken from its header
 	ReplacementStrategy strategy;
 	void *mgmtData; // use this one to store the bookkeeping info your buffer
 	// manager needs for a buffer pool
@@ -31,8 +39,71 @@ typedef struct BM_BufferPool {
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
+	int fileId;  // page file of the page, 0 is the pool's own pageFile
 } BM_PageHandle;
 
+// Progress of the current or last checkpoint of a pool
+typedef struct BM_CheckpointStatus {
+	bool active;  // a checkpoint has begun and still has pages to write
+	int numPages;  // pages in its dirty page table
+	int pagesDone;  // of those, pages written or found clean already
+	LSN beginLSN;  // log end when the checkpoint began
+	int numDirtyPages;  // dirty frames right now
+	LSN oldestDirtyLSN;  // smallest recLSN among them, redo would have to start here; 0 is the log start
+	LSN redoLSN;  // where recovery starts after the last completed checkpoint
+} BM_CheckpointStatus;
+
+// Latch modes of pinPageLatched
+typedef enum BM_LatchMode {
+	BM_LATCH_SHARED = 0,  // readers, any number at once
+	BM_LATCH_EXCLUSIVE = 1  // a single writer
+} BM_LatchMode;
+
+// What a pin says about the page's future, for replacement; the latest pin of a page decides
+typedef enum BM_PinHint {
+	BM_HINT_NORMAL = 0,  // up to the replacement strategy
+	BM_HINT_KEEP_HOT = 1,  // passed over once when the strategy picks it for replacement
+	BM_HINT_EVICT_SOON = 2,  // replaced before the strategy's choice
+	BM_HINT_WILL_NOT_NEED = 3  // written back if dirty and dropped once unpinned
+} BM_PinHint;
+
+// A page read without pinning it, see lookupPageOptimistic
+typedef struct BM_OptimisticRead {
+	PageNumber pageNum;
+	int fileId;
+	char *data;  // what is read from here counts only once validateOptimisticRead agrees
+	void *frame;  // latch of the frame the page was found in
+	unsigned long version;  // of the frame when the read began
+} BM_OptimisticRead;
+
+// Called by pollPinCompletions for a pinPageAsync request, page is pinned if rc is RC_OK
+typedef void (*BM_PinCallback)(BM_BufferPool *const bm, BM_PageHandle *const page, RC rc, void *ctx);
+
+// Replacement policy, passed as stratData to initBufferPool or set with setReplacementPolicy. Called with the
+// pool lock held, frame is an index into the pool's frames; hooks other than chooseVictim may be NULL
+typedef struct BM_ReplacementPolicy {
+	void (*onHit)(BM_BufferPool *const bm, void *data, const int frame);  // a pin found the page in frame
+	void (*onLoad)(BM_BufferPool *const bm, void *data, const int frame);  // a page was read into frame and pinned
+	void (*onUnpin)(BM_BufferPool *const bm, void *data, const int frame);  // the last pin of frame was released
+	int (*chooseVictim)(BM_BufferPool *const bm, void *data);  // an unpinned frame whose page should go, -1 for none
+	void (*onEvict)(BM_BufferPool *const bm, void *data, const int frame);  // frame's page leaves the pool
+	void (*onMove)(BM_BufferPool *const bm, void *data, const int from, const int to);  // a shrinking resize moved the page of from to the free frame to
+	void *data;  // the policy's own state, handed to every call
+} BM_ReplacementPolicy;
+
+// Tenants sharing a pool, see pinPageForTenant; other pins belong to BM_DEFAULT_TENANT
+#define MAX_TENANTS 16
+#define BM_DEFAULT_TENANT 0
+
+// Moves frames between the pools registered with it, towards the pool that gains the most hits
+#define MAX_BROKER_POOLS 16
+typedef struct BM_MemoryBroker {
+	BM_BufferPool *pools[MAX_BROKER_POOLS];
+	int numPools;
+	int framesPerMove;  // frames moved by one rebalance
+	int minPagesPerPool;  // no pool is shrunk below this
+} BM_MemoryBroker;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -42,20 +113,114 @@ typedef struct BM_PageHandle {
 
 // Buffer Manager Interface Pool Handling
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData);
+RC initBufferPoolReadOnly(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC setCompressedTierSize(BM_BufferPool *const bm, const size_t numBytes);
+RC attachL2Cache(BM_BufferPool *const bm, char *cacheFileName, const int numPages);
+RC attachLog(BM_BufferPool *const bm, WAL_Log *log);
+RC setReplacementPolicy(BM_BufferPool *const bm, const BM_ReplacementPolicy *policy);
+
+// Page files sharing the frames of a pool
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *fileId);
+RC setFileQuota(BM_BufferPool *const bm, const int fileId, const int maxFrames);
+
+// Tenants sharing the frames of a pool
+RC setTenantQuota(BM_BufferPool *const bm, const int tenantId, const int minFrames, const int maxFrames);
+
+// Free frames kept ready by a background evictor
+RC setFreeFrameWatermarks(BM_BufferPool *const bm, const int lowWatermark, const int highWatermark);
+int getNumFreeFrames(BM_BufferPool *const bm);
+int getNumBackgroundEvictions(BM_BufferPool *const bm);
+
+// Back-pressure when every frame is pinned
+RC setPinWaitTimeout(BM_BufferPool *const bm, const int millis);
+int getNumPinWaits(BM_BufferPool *const bm);
+long getPinWaitMicros(BM_BufferPool *const bm);
+int getNumPinTimeouts(BM_BufferPool *const bm);
+
+// Sticky pages, never replaced while other unpinned pages are left
+RC setStickyLimit(BM_BufferPool *const bm, const int maxPercent);
+RC setPageSticky(BM_BufferPool *const bm, const int fileId, const PageNumber pageNum, const bool sticky);
+int getNumStickyPages(BM_BufferPool *const bm);
+
+// Clean-first eviction, for storage where writes cost more than reads
+RC setCleanFirstWindow(BM_BufferPool *const bm, const int maxPercent, const bool adaptive);
+int getCleanFirstWindow(BM_BufferPool *const bm);
+int getNumCleanFirstEvictions(BM_BufferPool *const bm);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC pinPageWithHint (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_PinHint hint);
+RC pinFilePage (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId, const PageNumber pageNum);
+RC pinFilePageWithHint (BM_BufferPool *const bm, BM_PageHandle *const page, const int fileId, const PageNumber pageNum, const BM_PinHint hint);
+RC pinPageForTenant (BM_BufferPool *const bm, BM_PageHandle *const page, const int tenantId, const int fileId, const PageNumber pageNum,
+		const BM_PinHint hint);
+RC logPageUpdate (BM_BufferPool *const bm, BM_PageHandle *const page, const int offset, const int length, LSN *lsn);
+
+// Pinning without blocking on the disk
+RC pinPageAsync (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, BM_PinCallback callback, void *ctx);
+RC pollPinCompletions (BM_BufferPool *const bm, const int maxCompletions, const bool wait, int *numCompleted);
+int getPinCompletionFd (BM_BufferPool *const bm);
+int getNumPendingPins (BM_BufferPool *const bm);
+int getNumMergedPins (BM_BufferPool *const bm);
+
+// Latching pinned pages, so readers and writers of a page needn't serialize on the pool
+RC pinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_LatchMode mode);
+RC tryPinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, const BM_LatchMode mode);
+RC upgradeLatch (BM_BufferPool *const bm, BM_PageHandle *const page);
+RC downgradeLatch (BM_BufferPool *const bm, BM_PageHandle *const page);
+RC unpinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page, const BM_LatchMode mode);
+
+// Reading resident pages without a pin, checked afterwards against the frame's version
+RC lookupPageOptimistic (BM_BufferPool *const bm, const PageNumber pageNum, BM_OptimisticRead *read);
+RC beginOptimisticRead (BM_OptimisticRead *read);
+bool validateOptimisticRead (BM_OptimisticRead *read);
+
+// Page allocation in files created with SM_FREE_SPACE_MAP
+RC allocatePage (BM_BufferPool *const bm, const int fileId, const int numPages, PageNumber *firstPage);
+RC freePage (BM_BufferPool *const bm, const int fileId, const PageNumber firstPage, const int numPages);
+
+// Resizing and memory broker
+RC resizeBufferPool (BM_BufferPool *const bm, const int newNumPages);
+RC getMarginalHits (BM_BufferPool *const bm, const int numFrames, int *gain, int *loss);
+BM_MemoryBroker *createMemoryBroker (const int framesPerMove, const int minPagesPerPool);
+RC brokerAddPool (BM_MemoryBroker *broker, BM_BufferPool *const bm);
+RC rebalanceMemory (BM_MemoryBroker *broker, int *framesMoved);
+void destroyMemoryBroker (BM_MemoryBroker *broker);
+
+// Checkpoints
+RC beginCheckpoint (BM_BufferPool *const bm);
+RC checkpointStep (BM_BufferPool *const bm, const int maxPages);
+RC startCheckpoint (BM_BufferPool *const bm, const int pagesPerSecond);
+RC waitForCheckpoint (BM_BufferPool *const bm);
+RC getCheckpointStatus (BM_BufferPool *const bm, BM_CheckpointStatus *status);
+
+// Warm-up after a restart
+RC saveWarmList (BM_BufferPool *const bm);
+RC enableWarmList (BM_BufferPool *const bm, const int saveIntervalMillis);
+RC warmUpBufferPool (BM_BufferPool *const bm, const bool background);
+RC waitForWarmUp (BM_BufferPool *const bm);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
 bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
+int *getFrameFileIds (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumTierHits (BM_BufferPool *const bm);
+int getNumL2Hits (BM_BufferPool *const bm);
+int getNumWarmedPages (BM_BufferPool *const bm);
+int getNumLatchWaits (BM_BufferPool *const bm);
+long getLatchWaitMicros (BM_BufferPool *const bm);
+RC getTenantStats (BM_BufferPool *const bm, const int tenantId, int *numFrames, int *numHits, int *numMisses);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,388 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "storage_mgr.h"
+
+/*
+ * Header-only buffer pool for C++ callers, over the same storage manager and page files
+ * as buffer_mgr.c. The replacement policy and the page size are template parameters, so
+ * nothing on a hit is dispatched at run time: it is a hash lookup, a pin count and the
+ * policy's bookkeeping, all inlined. PinGuard unpins when it goes out of scope.
+ *
+ * It covers pinning the pages of one page file. The write-ahead log, latches, tiers and
+ * background threads of the C pool are not here, use the C API for those. A miss reads
+ * the page with the pool lock held, like buffer_mgr.c does.
+ *
+ * A policy is a class with these members, called with the pool lock held:
+ *   void init (int numFrames);
+ *   void onHit (int frame);     the page in frame was pinned again
+ *   void onLoad (int frame);    a page was read into frame
+ *   void onUnpin (int frame);   the last pin of frame was released
+ *   void onEvict (int frame);   the page of frame is being replaced
+ *   template <class Pinned> int chooseVictim (Pinned pinned);
+ *                               a frame with !pinned(frame) to replace, -1 if there is none
+ */
+namespace bufmgr {
+
+// Frames in a list, newest first; the victim is the oldest unpinned one. MoveOnHit makes it LRU, else FIFO
+template <bool MoveOnHit>
+class ListPolicy
+{
+public:
+	void init (int numFrames)
+	{
+		prev.assign(numFrames, -1);
+		next.assign(numFrames, -1);
+		newest = oldest = -1;
+	}
+
+	void onHit (int frame)
+	{
+		if (MoveOnHit && frame != newest)
+		{
+			unlink(frame);
+			pushNewest(frame);
+		}
+	}
+
+	void onLoad (int frame) { pushNewest(frame); }
+	void onUnpin (int) {}
+	void onEvict (int frame) { unlink(frame); }
+
+	template <class Pinned>
+	int chooseVictim (Pinned pinned)
+	{
+		int frame;
+		for (frame = oldest; frame >= 0; frame = prev[frame])
+		{
+			if (!pinned(frame))
+				return frame;
+		}
+		return -1;
+	}
+
+private:
+	std::vector<int> prev, next;  // toward the newest and the oldest frame
+	int newest, oldest;
+
+	void unlink (int frame)
+	{
+		if (prev[frame] >= 0)
+			next[prev[frame]] = next[frame];
+		else
+			newest = next[frame];
+		if (next[frame] >= 0)
+			prev[next[frame]] = prev[frame];
+		else
+			oldest = prev[frame];
+		prev[frame] = next[frame] = -1;
+	}
+
+	void pushNewest (int frame)
+	{
+		prev[frame] = -1;
+		next[frame] = newest;
+		if (newest >= 0)
+			prev[newest] = frame;
+		else
+			oldest = frame;
+		newest = frame;
+	}
+};
+
+typedef ListPolicy<true> LruPolicy;
+typedef ListPolicy<false> FifoPolicy;
+
+
+// Second chance: the hand clears reference bits until it finds an unpinned frame without one
+class ClockPolicy
+{
+public:
+	void init (int numFrames)
+	{
+		refBit.assign(numFrames, 0);
+		hand = 0;
+	}
+
+	void onHit (int frame) { refBit[frame] = 1; }
+	void onLoad (int frame) { refBit[frame] = 1; }
+	void onUnpin (int) {}
+	void onEvict (int) {}
+
+	template <class Pinned>
+	int chooseVictim (Pinned pinned)
+	{
+		int numFrames = (int) refBit.size();
+		int step;
+		for (step = 0; step < 2 * numFrames; step++)  // two turns clear every bit
+		{
+			int frame = hand;
+			hand = (hand + 1) % numFrames;
+			if (pinned(frame))
+				continue;
+			if (!refBit[frame])
+				return frame;
+			refBit[frame] = 0;
+		}
+		return -1;
+	}
+
+private:
+	std::vector<unsigned char> refBit;
+	int hand;
+};
+
+
+template <class Policy, int PageSize = PAGE_SIZE>
+class BufferPool
+{
+	static_assert(PageSize >= MIN_PAGE_SIZE && PageSize <= MAX_PAGE_SIZE && (PageSize & (PageSize - 1)) == 0,
+			"page sizes are powers of two the storage manager supports");
+
+	struct Frame
+	{
+		PageNumber pageNum;
+		int fixCount;
+		bool dirty;
+	};
+
+public:
+	// A pin on a page, released when the guard is destroyed or another pin is moved into it
+	class PinGuard
+	{
+	public:
+		PinGuard () : pool(NULL), frame(-1) {}
+		PinGuard (const PinGuard &) = delete;
+		PinGuard &operator= (const PinGuard &) = delete;
+		PinGuard (PinGuard &&other) : pool(other.pool), frame(other.frame) { other.pool = NULL; }
+
+		PinGuard &operator= (PinGuard &&other)
+		{
+			if (this != &other)
+			{
+				release();
+				pool = other.pool;
+				frame = other.frame;
+				other.pool = NULL;
+			}
+			return *this;
+		}
+
+		~PinGuard () { release(); }
+
+		bool pinned () const { return pool != NULL; }
+		char *data () const { return pool->pageData(frame); }
+		PageNumber pageNum () const { return pool->frames[frame].pageNum; }
+		void markDirty () { pool->markDirty(frame); }
+
+		void release ()
+		{
+			if (pool != NULL)
+				pool->unpin(frame);
+			pool = NULL;
+		}
+
+	private:
+		friend class BufferPool;
+		BufferPool *pool;
+		int frame;
+	};
+
+	BufferPool () : isOpen(false), data(NULL), numReadIO(0), numWriteIO(0) {}
+	BufferPool (const BufferPool &) = delete;
+	BufferPool &operator= (const BufferPool &) = delete;
+	~BufferPool () { close(); }
+
+	RC open (const char *fileName, int numFrames)
+	{
+		if (isOpen || numFrames <= 0)
+			return RC_ERROR;
+		RC rc = openPageFile(const_cast<char *>(fileName), &fh);
+		if (rc != RC_OK)
+			return rc;
+		if (fh.pageSize != PageSize)
+		{
+			closePageFile(&fh);
+			return RC_INVALID_PAGE_SIZE;
+		}
+		void *buffers;
+		if (posix_memalign(&buffers, MIN_PAGE_SIZE, (size_t) PageSize * numFrames) != 0)
+		{
+			closePageFile(&fh);
+			return RC_ERROR;
+		}
+		data = (char *) buffers;
+		frames.assign(numFrames, Frame{NO_PAGE, 0, false});
+		freeFrames.clear();
+		for (int i = numFrames - 1; i >= 0; i--)
+			freeFrames.push_back(i);
+		table.clear();
+		table.reserve(numFrames);
+		policy.init(numFrames);
+		numReadIO = numWriteIO = 0;
+		isOpen = true;
+		return RC_OK;
+	}
+
+	// Write the dirty pages and close the file; pins still held are the caller's bug, as in shutdownBufferPool
+	RC close ()
+	{
+		if (!isOpen)
+			return RC_OK;
+		std::unique_lock<std::mutex> guard(lock);
+		for (const Frame &f : frames)
+		{
+			if (f.fixCount > 0)
+				return RC_BUFFER_IN_USE_BY_CLIENT;
+		}
+		RC rc = flushLocked();
+		closePageFile(&fh);
+		free(data);
+		data = NULL;
+		isOpen = false;
+		return rc;
+	}
+
+	// The hit path: everything down to the policy's onHit is inlined here
+	RC pin (PageNumber pageNum, PinGuard &guard)
+	{
+		if (pageNum < 0)
+			return RC_READ_NON_EXISTING_PAGE;
+		guard.release();
+		std::unique_lock<std::mutex> hold(lock);
+		typename std::unordered_map<PageNumber, int>::const_iterator found = table.find(pageNum);
+		int frame;
+		if (found != table.end())
+		{
+			frame = found->second;
+			frames[frame].fixCount += 1;
+			policy.onHit(frame);
+		}
+		else
+		{
+			RC rc = load(pageNum, &frame);
+			if (rc != RC_OK)
+				return rc;
+		}
+		guard.pool = this;
+		guard.frame = frame;
+		return RC_OK;
+	}
+
+	RC flush ()
+	{
+		std::unique_lock<std::mutex> hold(lock);
+		return flushLocked();
+	}
+
+	int getNumReadIO () const { return numReadIO; }
+	int getNumWriteIO () const { return numWriteIO; }
+	int getNumFrames () const { return (int) frames.size(); }
+
+private:
+	SM_FileHandle fh;
+	bool isOpen;
+	std::mutex lock;
+	std::vector<Frame> frames;
+	char *data;  // PageSize bytes per frame, in one block
+	std::unordered_map<PageNumber, int> table;  // resident page -> frame
+	std::vector<int> freeFrames;
+	Policy policy;
+	int numReadIO;
+	int numWriteIO;
+
+	char *pageData (int frame) const { return data + (size_t) frame * PageSize; }
+
+	void markDirty (int frame)
+	{
+		std::unique_lock<std::mutex> hold(lock);
+		frames[frame].dirty = true;
+	}
+
+	void unpin (int frame)
+	{
+		std::unique_lock<std::mutex> hold(lock);
+		if (--frames[frame].fixCount == 0)
+			policy.onUnpin(frame);
+	}
+
+	RC writeFrame (int frame)
+	{
+		RC rc = writeBlock(frames[frame].pageNum, &fh, pageData(frame));  // stamps the checksum trailer if the file has them
+		if (rc != RC_OK)
+			return rc;
+		frames[frame].dirty = false;
+		numWriteIO += 1;
+		return RC_OK;
+	}
+
+	RC flushLocked ()
+	{
+		for (int i = 0; i < (int) frames.size(); i++)
+		{
+			if (frames[i].pageNum != NO_PAGE && frames[i].dirty && frames[i].fixCount == 0)
+			{
+				RC rc = writeFrame(i);
+				if (rc != RC_OK)
+					return rc;
+			}
+		}
+		return RC_OK;
+	}
+
+	// A free frame, else the policy's victim once its page is written back
+	RC load (PageNumber pageNum, int *frame)
+	{
+		int f;
+		if (!freeFrames.empty())
+		{
+			f = freeFrames.back();
+			freeFrames.pop_back();
+		}
+		else
+		{
+			f = policy.chooseVictim([this] (int i) { return frames[i].fixCount > 0; });
+			if (f < 0)
+				return RC_ALL_FRAMES_PINNED;
+			if (frames[f].dirty)
+			{
+				RC rc = writeFrame(f);
+				if (rc != RC_OK)
+					return rc;
+			}
+			policy.onEvict(f);
+			table.erase(frames[f].pageNum);
+			frames[f].pageNum = NO_PAGE;
+		}
+
+		if (pageNum >= fh.totalNumPages)
+			refreshPageCount(&fh);  // another handle may have grown the file
+		RC rc = RC_OK;
+		if (pageNum >= fh.totalNumPages)  // never written: zeros, the file grows when the page is written back
+			memset(pageData(f), 0, PageSize);
+		else
+		{
+			rc = readBlock(pageNum, &fh, pageData(f));
+			numReadIO += 1;
+		}
+		if (rc != RC_OK)
+		{
+			freeFrames.push_back(f);
+			return rc;
+		}
+		frames[f] = Frame{pageNum, 1, false};
+		table.emplace(pageNum, f);
+		policy.onLoad(f);
+		*frame = f;
+		return RC_OK;
+	}
+};
+
+}  // namespace bufmgr
+
+#endif
@@ -0,0 +1,201 @@
+#include <string.h>
+#include <pthread.h>
+#include "checksum.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM 1
+#endif
+
+/*
+ * CRC32C uses the CRC instructions when the CPU has them (SSE4.2 on x86, checked at
+ * run time; the CRC extension on ARMv8, when the compiler targets it) and falls back to
+ * slicing-by-8 tables otherwise. Both give the same result, the one to use is picked on
+ * the first call.
+ */
+#define CRC32C_POLY 0x82F63B78  // reflected Castagnoli polynomial
+
+static uint32_t crcTable[8][256];
+static uint32_t (*crc32cImpl) (uint32_t, const unsigned char *, size_t);
+static pthread_once_t crc32cOnce = PTHREAD_ONCE_INIT;
+
+
+static uint32_t crc32cTables (uint32_t crc, const unsigned char *p, size_t n)
+{
+	while (n > 0 && ((uintptr_t) p & 7) != 0)
+	{
+		crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		n--;
+	}
+	while (n >= 8)  // eight table lookups per eight bytes, independent of each other
+	{
+		uint32_t lo, hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF]
+			^ crcTable[5][(lo >> 16) & 0xFF] ^ crcTable[4][lo >> 24]
+			^ crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF]
+			^ crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+		p += 8;
+		n -= 8;
+	}
+	while (n-- > 0)
+		crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+
+#if CRC32C_X86
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#define CRC_BYTE(crc, b) _mm_crc32_u8(crc, b)
+#define CRC_WORD(crc, w) ((uint32_t) _mm_crc32_u64(crc, w))
+#elif CRC32C_ARM
+#define CRC32C_TARGET
+#define CRC_BYTE(crc, b) __crc32cb(crc, b)
+#define CRC_WORD(crc, w) __crc32cd(crc, w)
+#endif
+
+#ifdef CRC_WORD
+/*
+ * One CRC instruction has to wait for the previous one, so a page is cut into three
+ * lanes of CRC32C_LANE bytes that are run side by side and joined afterwards: the CRC
+ * of A followed by B is the CRC of A shifted over |B| zero bytes, xored with the CRC of
+ * B alone. The shift over one lane is a linear map, applied through shiftTable.
+ */
+#define CRC32C_LANE 256
+static uint32_t shiftTable[4][256];
+
+
+static uint32_t shiftLane (uint32_t crc)
+{
+	return shiftTable[0][crc & 0xFF] ^ shiftTable[1][(crc >> 8) & 0xFF]
+		^ shiftTable[2][(crc >> 16) & 0xFF] ^ shiftTable[3][crc >> 24];
+}
+
+
+CRC32C_TARGET
+static uint32_t crc32cHardware (uint32_t crc, const unsigned char *p, size_t n)
+{
+	while (n > 0 && ((uintptr_t) p & 7) != 0)
+	{
+		crc = CRC_BYTE(crc, *p++);
+		n--;
+	}
+	while (n >= 3 * CRC32C_LANE)
+	{
+		uint32_t a = crc, b = 0, c = 0;
+		int i;
+		for (i = 0; i < CRC32C_LANE; i += 8)
+		{
+			uint64_t va, vb, vc;
+			memcpy(&va, p + i, 8);
+			memcpy(&vb, p + CRC32C_LANE + i, 8);
+			memcpy(&vc, p + 2 * CRC32C_LANE + i, 8);
+			a = CRC_WORD(a, va);
+			b = CRC_WORD(b, vb);
+			c = CRC_WORD(c, vc);
+		}
+		crc = shiftLane(shiftLane(a) ^ b) ^ c;
+		p += 3 * CRC32C_LANE;
+		n -= 3 * CRC32C_LANE;
+	}
+	while (n >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, p, 8);
+		crc = CRC_WORD(crc, v);
+		p += 8;
+		n -= 8;
+	}
+	while (n-- > 0)
+		crc = CRC_BYTE(crc, *p++);
+	return crc;
+}
+#endif
+
+
+static void initCrc32c (void)
+{
+	int i, k;
+	for (i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for (k = 0; k < 8; k++)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+		crcTable[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++)  // table k advances a byte by k more zero bytes
+	{
+		for (k = 1; k < 8; k++)
+			crcTable[k][i] = crcTable[0][crcTable[k - 1][i] & 0xFF] ^ (crcTable[k - 1][i] >> 8);
+	}
+
+	crc32cImpl = crc32cTables;
+#ifdef CRC_WORD
+	static const unsigned char zeros[CRC32C_LANE];
+	for (k = 0; k < 4; k++)  // shifting is linear, so it splits into one table per byte of the CRC
+	{
+		for (i = 0; i < 256; i++)
+			shiftTable[k][i] = crc32cTables((uint32_t) i << (8 * k), zeros, CRC32C_LANE);
+	}
+#if CRC32C_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.2"))
+		crc32cImpl = crc32cHardware;
+#else
+	crc32cImpl = crc32cHardware;
+#endif
+#endif
+}
+
+
+extern uint32_t crc32c (uint32_t crc, const void *data, size_t length)
+{
+	pthread_once(&crc32cOnce, initCrc32c);
+	return ~crc32cImpl(~crc, (const unsigned char *) data, length);
+}
+
+
+extern uint32_t crc32cPortable (uint32_t crc, const void *data, size_t length)
+{
+	pthread_once(&crc32cOnce, initCrc32c);
+	return ~crc32cTables(~crc, (const unsigned char *) data, length);
+}
+
+
+extern bool crc32cIsHardware (void)
+{
+	pthread_once(&crc32cOnce, initCrc32c);
+	return crc32cImpl != crc32cTables;
+}
+
+
+// The trailer covers everything in front of it
+extern void stampPageChecksum (char *page, int pageSize)
+{
+	uint32_t crc = crc32c(0, page, pageSize - PAGE_CHECKSUM_SIZE);
+	memcpy(page + pageSize - PAGE_CHECKSUM_SIZE, &crc, PAGE_CHECKSUM_SIZE);
+}
+
+
+// A page of zeros, trailer included, was added to the file and never written: it passes
+extern bool verifyPageChecksum (const char *page, int pageSize)
+{
+	uint32_t stored;
+	int i;
+	memcpy(&stored, page + pageSize - PAGE_CHECKSUM_SIZE, PAGE_CHECKSUM_SIZE);
+	if (stored == crc32c(0, page, pageSize - PAGE_CHECKSUM_SIZE))
+		return true;
+	if (stored != 0)
+		return false;
+	for (i = 0; i < pageSize - PAGE_CHECKSUM_SIZE; i++)
+	{
+		if (page[i] != 0)
+			return false;
+	}
+	return true;
+}
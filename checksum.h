@@ -0,0 +1,23 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dt.h"
+
+// Pages of a checksummed page file end in a CRC32C of the rest of the page
+#define PAGE_CHECKSUM_SIZE 4
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+/* CRC32C (Castagnoli), crc is 0 to start or the result for the preceding bytes */
+extern uint32_t crc32c (uint32_t crc, const void *data, size_t length);
+extern uint32_t crc32cPortable (uint32_t crc, const void *data, size_t length);
+extern bool crc32cIsHardware (void);
+
+/* page trailers */
+extern void stampPageChecksum (char *page, int pageSize);
+extern bool verifyPageChecksum (const char *page, int pageSize);
+
+#endif
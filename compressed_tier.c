@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "compressed_tier.h"
+
+/*
+ * Pages are compressed with a small LZ77 coder in the style of LZ4. The output is a
+ * sequence of (token, literals, offset, match) groups: the token holds the literal
+ * length in its high nibble and the match length minus LZ_MIN_MATCH in its low nibble,
+ * a nibble of 15 continues in extra bytes of 255. The last group has literals only.
+ */
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+#define CT_MIN_SAVING 8  // keep a page only if it shrinks by at least 1/8
+
+
+static unsigned int lzHash (const unsigned char *p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+// Write the part of a length that does not fit in its token nibble
+static unsigned char *lzPutLength (unsigned char *op, int len)
+{
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char) len;
+	return op;
+}
+
+
+extern int lzCompressBound (int srcLen)
+{
+	return srcLen + srcLen / 255 + 16;
+}
+
+
+// Returns the compressed size, or 0 if it does not fit in dstCap
+extern int lzCompress (const char *src, int srcLen, char *dst, int dstCap)
+{
+	const unsigned char *base = (const unsigned char *) src;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;  // start of pending literals
+	const unsigned char *end = base + srcLen;
+	unsigned char *op = (unsigned char *) dst;
+	unsigned char *oend = op + dstCap;
+	int table[1 << LZ_HASH_BITS];
+	int litLen;
+
+	memset(table, -1, sizeof(table));
+	while (ip + LZ_MIN_MATCH <= end)
+	{
+		unsigned int h = lzHash(ip);
+		int ref = table[h];
+		table[h] = ip - base;
+		if (ref < 0 || ip - (base + ref) > LZ_MAX_OFFSET || memcmp(base + ref, ip, LZ_MIN_MATCH) != 0)
+		{
+			ip++;
+			continue;
+		}
+
+		// Extend the match as far as it goes
+		const unsigned char *match = base + ref;
+		int matchLen = LZ_MIN_MATCH;
+		while (ip + matchLen < end && match[matchLen] == ip[matchLen])
+			matchLen++;
+
+		litLen = ip - anchor;
+		if (op + 1 + litLen + litLen / 255 + 1 + 2 + matchLen / 255 + 1 > oend)
+			return 0;
+		unsigned char *token = op++;
+		*token = (unsigned char) (((litLen < 15) ? litLen : 15) << 4);
+		if (litLen >= 15)
+			op = lzPutLength(op, litLen - 15);
+		memcpy(op, anchor, litLen);
+		op += litLen;
+		*op++ = (unsigned char) ((ip - match) & 0xFF);
+		*op++ = (unsigned char) ((ip - match) >> 8);
+		if (matchLen - LZ_MIN_MATCH >= 15)
+		{
+			*token |= 15;
+			op = lzPutLength(op, matchLen - LZ_MIN_MATCH - 15);
+		}
+		else
+			*token |= (unsigned char) (matchLen - LZ_MIN_MATCH);
+
+		ip += matchLen;
+		anchor = ip;
+	}
+
+	// Remaining bytes go out as literals
+	litLen = end - anchor;
+	if (op + 1 + litLen + litLen / 255 + 1 > oend)
+		return 0;
+	*op++ = (unsigned char) (((litLen < 15) ? litLen : 15) << 4);
+	if (litLen >= 15)
+		op = lzPutLength(op, litLen - 15);
+	memcpy(op, anchor, litLen);
+	op += litLen;
+	return op - (unsigned char *) dst;
+}
+
+
+// Returns the decompressed size, or -1 if the input is corrupt
+extern int lzDecompress (const char *src, int srcLen, char *dst, int dstCap)
+{
+	const unsigned char *ip = (const unsigned char *) src;
+	const unsigned char *iend = ip + srcLen;
+	unsigned char *op = (unsigned char *) dst;
+	unsigned char *oend = op + dstCap;
+
+	while (ip < iend)
+	{
+		int token = *ip++;
+		int litLen = token >> 4;
+		int matchLen = token & 15;
+		int offset, b;
+
+		if (litLen == 15)
+		{
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				litLen += b;
+			} while (b == 255);
+		}
+		if (litLen > iend - ip || litLen > oend - op)
+			return -1;
+		memcpy(op, ip, litLen);
+		op += litLen;
+		ip += litLen;
+		if (ip >= iend)  // last group carries no match
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (matchLen == 15)
+		{
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				matchLen += b;
+			} while (b == 255);
+		}
+		matchLen += LZ_MIN_MATCH;
+		if (offset == 0 || offset > op - (unsigned char *) dst || matchLen > oend - op)
+			return -1;
+
+		// Byte by byte, matches may overlap the bytes they produce
+		const unsigned char *match = op - offset;
+		while (matchLen-- > 0)
+			*op++ = *match++;
+	}
+	return op - (unsigned char *) dst;
+}
+
+
+static CT_Entry **bucketOf (CT_Cache *tier, int pageNum)
+{
+	return &tier->buckets[(unsigned int) pageNum % tier->numBuckets];
+}
+
+
+// Unlink an entry from the hash chain and the LRU list and free it
+static void removeEntry (CT_Cache *tier, CT_Entry *entry)
+{
+	CT_Entry **link = bucketOf(tier, entry->pageNum);
+	while (*link != entry)
+		link = &(*link)->hashNext;
+	*link = entry->hashNext;
+
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else
+		tier->head = entry->next;
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else
+		tier->tail = entry->prev;
+
+	tier->used -= sizeof(CT_Entry) + entry->size;
+	tier->numEntries -= 1;
+	free(entry->data);
+	free(entry);
+}
+
+
+static CT_Entry *findEntry (CT_Cache *tier, int pageNum)
+{
+	CT_Entry *entry = *bucketOf(tier, pageNum);
+	while (entry != NULL && entry->pageNum != pageNum)
+		entry = entry->hashNext;
+	return entry;
+}
+
+
+extern CT_Cache *createCompressedTier (size_t capacity, int pageSize)
+{
+	CT_Cache *tier = (CT_Cache *) calloc(1, sizeof(CT_Cache));
+	tier->capacity = capacity;
+	tier->pageSize = pageSize;
+	// Size the table for pages compressing about 3x
+	tier->numBuckets = capacity / (pageSize / 3 + sizeof(CT_Entry)) + 1;
+	tier->buckets = (CT_Entry **) calloc(tier->numBuckets, sizeof(CT_Entry *));
+	tier->scratch = (char *) malloc(lzCompressBound(pageSize));
+	return tier;
+}
+
+
+extern void destroyCompressedTier (CT_Cache *tier)
+{
+	while (tier->head != NULL)
+		removeEntry(tier, tier->head);
+	free(tier->buckets);
+	free(tier->scratch);
+	free(tier);
+}
+
+
+// Store a compressed copy of a clean page, making room by dropping the oldest copies
+extern bool putCompressedPage (CT_Cache *tier, int pageNum, const char *page)
+{
+	int size = lzCompress(page, tier->pageSize, tier->scratch, tier->pageSize - tier->pageSize / CT_MIN_SAVING);
+	CT_Entry *entry;
+
+	dropCompressedPage(tier, pageNum);
+	if (size == 0 || sizeof(CT_Entry) + size > tier->capacity)
+	{
+		tier->rejected += 1;
+		return false;
+	}
+	while (tier->used + sizeof(CT_Entry) + size > tier->capacity)
+		removeEntry(tier, tier->tail);
+
+	entry = (CT_Entry *) malloc(sizeof(CT_Entry));
+	entry->pageNum = pageNum;
+	entry->size = size;
+	entry->data = (char *) malloc(size);
+	memcpy(entry->data, tier->scratch, size);
+
+	entry->hashNext = *bucketOf(tier, pageNum);
+	*bucketOf(tier, pageNum) = entry;
+	entry->prev = NULL;
+	entry->next = tier->head;
+	if (tier->head != NULL)
+		tier->head->prev = entry;
+	tier->head = entry;
+	if (tier->tail == NULL)
+		tier->tail = entry;
+
+	tier->used += sizeof(CT_Entry) + size;
+	tier->numEntries += 1;
+	return true;
+}
+
+
+// Decompress a cached page into page and drop it from the tier, it lives in the pool again
+extern bool takeCompressedPage (CT_Cache *tier, int pageNum, char *page)
+{
+	CT_Entry *entry = findEntry(tier, pageNum);
+	if (entry == NULL)
+	{
+		tier->misses += 1;
+		return false;
+	}
+	if (lzDecompress(entry->data, entry->size, page, tier->pageSize) != tier->pageSize)
+	{
+		removeEntry(tier, entry);  // corrupt copy, fall back to the page file
+		tier->misses += 1;
+		return false;
+	}
+	removeEntry(tier, entry);
+	tier->hits += 1;
+	return true;
+}
+
+
+extern void dropCompressedPage (CT_Cache *tier, int pageNum)
+{
+	CT_Entry *entry = findEntry(tier, pageNum);
+	if (entry != NULL)
+		removeEntry(tier, entry);
+}
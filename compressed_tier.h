@@ -0,0 +1,50 @@
+#ifndef COMPRESSED_TIER_H
+#define COMPRESSED_TIER_H
+
+#include "dberror.h"
+#include "dt.h"
+
+/************************************************************
+ *                    handle data structures                *
+ ************************************************************/
+typedef struct CT_Entry {
+	int pageNum;
+	int size;  // compressed size in bytes
+	char *data;
+	struct CT_Entry *hashNext;
+	struct CT_Entry *prev;  // LRU list, most recently stored first
+	struct CT_Entry *next;
+} CT_Entry;
+
+// Cache of compressed copies of clean pages evicted from a buffer pool
+typedef struct CT_Cache {
+	size_t capacity;  // byte budget, entries and their bookkeeping included
+	size_t used;
+	int pageSize;
+	int numBuckets;
+	CT_Entry **buckets;
+	CT_Entry *head;
+	CT_Entry *tail;
+	char *scratch;  // compression output buffer
+	int numEntries;
+	int hits;
+	int misses;
+	int rejected;  // pages that did not compress well enough to keep
+} CT_Cache;
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+/* LZ compression of a single page */
+extern int lzCompressBound (int srcLen);
+extern int lzCompress (const char *src, int srcLen, char *dst, int dstCap);
+extern int lzDecompress (const char *src, int srcLen, char *dst, int dstCap);
+
+/* compressed page cache */
+extern CT_Cache *createCompressedTier (size_t capacity, int pageSize);
+extern void destroyCompressedTier (CT_Cache *tier);
+extern bool putCompressedPage (CT_Cache *tier, int pageNum, const char *page);
+extern bool takeCompressedPage (CT_Cache *tier, int pageNum, char *page);
+extern void dropCompressedPage (CT_Cache *tier, int pageNum);
+
+#endif
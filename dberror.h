@@ -3,8 +3,15 @@
 
 #include "stdio.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* module wide constants */
-#define PAGE_SIZE 4096
+#define PAGE_SIZE 4096  // default page size of new page files
+#define MIN_PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536
+#define PAGE_FILE_HEADER_SIZE 4096
 
 /* return code definitions */
 typedef int RC;
@@ -18,6 +25,15 @@ typedef int RC;
 #define RC_PAGE_WAS_NOT_MODIFIED 6
 #define RC_PINNED_PAGES_IN_BUFFER 7
 #define RC_ERROR 8
+#define RC_POOL_IS_READ_ONLY 9
+#define RC_INVALID_PAGE_SIZE 10
+#define RC_CHECKPOINT_IN_PROGRESS 11
+#define RC_PAGE_CHECKSUM_MISMATCH 12
+#define RC_NO_FREE_SPACE_MAP 13
+#define RC_PIN_PENDING 14  // pinPageAsync queued the read, the callback reports the pin
+#define RC_LATCH_BUSY 15
+#define RC_ALL_FRAMES_PINNED 16  // no frame was unpinned within the pool's pin wait timeout
+#define RC_STICKY_LIMIT 17  // the pool's sticky pages already take the share of frames it allows
 
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
@@ -59,4 +75,8 @@ extern char *errorMessage (RC error);
 		} while(0);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -1,9 +1,10 @@
 #ifndef DT_H
 #define DT_H
 
-// define bool if not defined
-#ifndef bool
-    typedef short bool;
+// define bool if not defined; C++ has its own, and _Bool has its size, so structs
+// with bool fields look the same from both languages
+#if !defined(bool) && !defined(__cplusplus)
+    typedef _Bool bool;
 #define true 1
 #define false 0
 #endif
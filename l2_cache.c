@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "l2_cache.h"
+
+/*
+ * The cache file is scratch space: its index only lives in memory, so the file is
+ * truncated when the cache is opened and removed when it is closed. Pages are only
+ * stored here after they match the page file, writes always go to the page file.
+ */
+#define NO_SLOT -1
+
+
+static int *bucketOf (L2_Cache *cache, int pageNum)
+{
+	return &cache->buckets[(unsigned int) pageNum % cache->numBuckets];
+}
+
+
+static int findSlot (L2_Cache *cache, int pageNum)
+{
+	int slot = *bucketOf(cache, pageNum);
+	while (slot != NO_SLOT && cache->slotPage[slot] != pageNum)
+		slot = cache->slotNext[slot];
+	return slot;
+}
+
+
+// Take a slot out of the index and mark it empty
+static void clearSlot (L2_Cache *cache, int slot)
+{
+	int *link = bucketOf(cache, cache->slotPage[slot]);
+	while (*link != slot)
+		link = &cache->slotNext[*link];
+	*link = cache->slotNext[slot];
+	cache->slotPage[slot] = NO_SLOT;
+	cache->refBit[slot] = false;
+}
+
+
+// Pick a slot for a new page: an empty one, or the first one CLOCK finds unreferenced
+static int chooseSlot (L2_Cache *cache)
+{
+	while (1)
+	{
+		int slot = cache->hand;
+		cache->hand = (cache->hand + 1) % cache->numSlots;
+		if (cache->slotPage[slot] == NO_SLOT)
+			return slot;
+		if (!cache->refBit[slot])
+		{
+			clearSlot(cache, slot);
+			return slot;
+		}
+		cache->refBit[slot] = false;
+	}
+}
+
+
+extern RC openL2Cache (char *fileName, int numSlots, int pageSize, L2_Cache **cache)
+{
+	int i;
+	L2_Cache *c;
+	int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return RC_FILE_NOT_FOUND;
+	if (ftruncate(fd, (off_t) numSlots * pageSize) != 0)  // reserve the whole cache up front
+	{
+		close(fd);
+		return RC_WRITE_FAILED;
+	}
+
+	c = (L2_Cache *) calloc(1, sizeof(L2_Cache));
+	c->fileName = fileName;
+	c->fd = fd;
+	c->pageSize = pageSize;
+	c->numSlots = numSlots;
+	c->numBuckets = numSlots;
+	c->slotPage = (int *) malloc(sizeof(int) * numSlots);
+	c->slotNext = (int *) malloc(sizeof(int) * numSlots);
+	c->refBit = (bool *) calloc(numSlots, sizeof(bool));
+	c->buckets = (int *) malloc(sizeof(int) * c->numBuckets);
+	for (i = 0; i < numSlots; i++)
+	{
+		c->slotPage[i] = NO_SLOT;
+		c->slotNext[i] = NO_SLOT;
+		c->buckets[i] = NO_SLOT;
+	}
+	*cache = c;
+	return RC_OK;
+}
+
+
+extern RC closeL2Cache (L2_Cache *cache)
+{
+	close(cache->fd);
+	remove(cache->fileName);  // contents are useless without the in-memory index
+	free(cache->slotPage);
+	free(cache->slotNext);
+	free(cache->refBit);
+	free(cache->buckets);
+	free(cache);
+	return RC_OK;
+}
+
+
+// Store a copy of a page that matches the page file, nothing is written if it is cached already
+extern RC putL2Page (L2_Cache *cache, int pageNum, char *page)
+{
+	int slot = findSlot(cache, pageNum);
+	if (slot != NO_SLOT)
+		return RC_OK;
+
+	slot = chooseSlot(cache);
+	if (pwrite(cache->fd, page, cache->pageSize, (off_t) slot * cache->pageSize) != cache->pageSize)
+		return RC_WRITE_FAILED;
+	cache->slotPage[slot] = pageNum;
+	cache->slotNext[slot] = *bucketOf(cache, pageNum);
+	*bucketOf(cache, pageNum) = slot;
+	cache->refBit[slot] = false;
+	cache->writes += 1;
+	return RC_OK;
+}
+
+
+extern bool getL2Page (L2_Cache *cache, int pageNum, char *page)
+{
+	int slot = findSlot(cache, pageNum);
+	if (slot == NO_SLOT)
+	{
+		cache->misses += 1;
+		return false;
+	}
+	if (pread(cache->fd, page, cache->pageSize, (off_t) slot * cache->pageSize) != cache->pageSize)
+	{
+		clearSlot(cache, slot);
+		cache->misses += 1;
+		return false;
+	}
+	cache->refBit[slot] = true;
+	cache->hits += 1;
+	return true;
+}
+
+
+// Forget the copy of a page, called whenever the page file copy changes
+extern void dropL2Page (L2_Cache *cache, int pageNum)
+{
+	int slot = findSlot(cache, pageNum);
+	if (slot != NO_SLOT)
+		clearSlot(cache, slot);
+}
@@ -0,0 +1,36 @@
+#ifndef L2_CACHE_H
+#define L2_CACHE_H
+
+#include "dberror.h"
+#include "dt.h"
+
+/************************************************************
+ *                    handle data structures                *
+ ************************************************************/
+// Secondary page cache kept in a fixed size file on a fast local device
+typedef struct L2_Cache {
+	char *fileName;
+	int fd;
+	int pageSize;
+	int numSlots;  // pages the cache file holds
+	int *slotPage;  // page held by each slot, -1 if the slot is empty
+	bool *refBit;  // CLOCK replacement over the slots
+	int hand;
+	int *buckets;  // index from page number to slot, chained through slotNext
+	int *slotNext;
+	int numBuckets;
+	int hits;
+	int misses;
+	int writes;  // pages written to the cache file
+} L2_Cache;
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+extern RC openL2Cache (char *fileName, int numSlots, int pageSize, L2_Cache **cache);
+extern RC closeL2Cache (L2_Cache *cache);
+extern RC putL2Page (L2_Cache *cache, int pageNum, char *page);
+extern bool getL2Page (L2_Cache *cache, int pageNum, char *page);
+extern void dropL2Page (L2_Cache *cache, int pageNum);
+
+#endif
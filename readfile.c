@@ -1,26 +1,22 @@
-// *** Use this to look at the blocks in the pagefile -> testbuffer.bin***
-#include <stdlib.h>
-#include<stdio.h>
-#include<string.h>
-
-void main()
-{
-    int PAGE_SIZE = 4096;
-    typedef char* SM_PageHandle;
-    SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
-    FILE *fp;
-    fp = fopen("testbuffer.bin", "r");
-    fseek(fp, 0, SEEK_END);
-    int totalNumPages = ftell(fp) / PAGE_SIZE;
-    int i;
-    fseek(fp,0,SEEK_SET);
-    for (i = 0; i < totalNumPages; i++)
-    {
-		//fseek to set the file position to offset
-		
-		//Now, read the contents and, store it in the location pointed by memPage
-		fread(ph,1,PAGE_SIZE,fp);
-        printf("block: %d --- content: %s\n", i, ph);
-    }
-    fclose(fp);
-}
\ No newline at end of file
+// *** Use this to look at the blocks in the pagefile -> testbuffer.bin***
+#include <stdlib.h>
+#include<stdio.h>
+#include<string.h>
+#include "storage_mgr.h"
+
+int main()
+{
+    SM_FileHandle fh;
+    SM_ScanCursor cursor;
+    SM_PageHandle ph;
+    if (openPageFile("testbuffer.bin", &fh) != RC_OK)
+        return 1;
+    // pages are streamed through large reads, the page size comes from the file header
+    if (openScanCursor(&fh, 0, fh.totalNumPages, 0, &cursor) != RC_OK)
+        return 1;
+    while (scanNextBlock(&cursor, &ph) == RC_OK)
+        printf("block: %d --- content: %.*s\n", getBlockPos(&fh), (int) strnlen(ph, fh.pageSize), ph);
+    closeScanCursor(&cursor);
+    closePageFile(&fh);
+    return 0;
+}
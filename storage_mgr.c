@@ -1,306 +1,716 @@
-#include <stdlib.h>
-#include<stdio.h>
-#include "storage_mgr.h"
-#include "dberror.h"
-#include<string.h>
-
-FILE *fp;
-//function definitions
-extern void initStorageManager (void)
-{
-	printf("SM Storage Manager has been initialized\n");  // Initialize storage manager
-	return;
-}
-
-
-extern RC createPageFile (char *fileName)
-{
-	fp = fopen(fileName, "w");  // Create/Overwrite a file
-	if (fp == NULL)  
-	{
-		fclose(fp);
-		exit(1);  // Exit if there is an error creating the file
-	}
-	else
-	{
-		int i;
-   		for(i = 0; i < PAGE_SIZE; i++)  // Fill in single page with 0 byte
-		{
-			fwrite("\0",1, 1,fp);
-			fseek(fp,0,SEEK_END);
-		}
-		fclose(fp);
-		return RC_OK;  // Return success code
-	}
-}
-	
-
-extern RC openPageFile (char *fileName, SM_FileHandle *fHandle)
-{
-	fp = fopen(fileName, "r+");  // Open in read + write mode and check if the file exists
-	if (fp == NULL)
-		return RC_FILE_NOT_FOUND;  // Return corresponding error code
-	else
-	{
-		fseek(fp, 0, SEEK_END);  // Move the stream to the end of file
-		// Update fHandle with file details
-		fHandle->fileName = fileName;  
-		fHandle->totalNumPages = ftell(fp) / PAGE_SIZE;  // Get total number of pages and store it
-		fHandle->mgmtInfo = fp;  //  Store the address of file pointer, so that it can be accessed by other functions
-		fHandle->curPagePos = 0;
-		fclose(fp);
-		return RC_OK;  // Return success code
-	}
-}
-
-
-extern RC closePageFile (SM_FileHandle *fHandle)
-{
-	fp = fHandle->mgmtInfo;  // Get file pointer stored in the data structure
-	if(fp != NULL)
-		fp = NULL;
-	return RC_OK;  // Return success code
-}
-
-
-extern RC destroyPageFile (char *fileName)
-{
-	fp = fopen(fileName, "r");  // Check if file exists
-	if (fp != NULL)
-	{
-		fclose(fp);
-		remove(fileName);  // Destroy the file
-		return RC_OK;
-	}
-	else
-		return RC_FILE_NOT_FOUND;
-}
-
-
-//Implementing function 1 readBlock
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
-{			
-	//check if the file is present or not
-	if(fopen(fHandle->fileName,"r") == NULL)
-		return RC_FILE_NOT_FOUND;
-	else
-	{
-		fp = fopen(fHandle->fileName, "r");
-		//defining offset
-		int offset = pageNum*PAGE_SIZE;
-		//fseek to set the file position to offset
-		fseek(fp,offset,SEEK_SET);
-		//Now, read the contents and, store it in the location pointed by memPage
-		fread(memPage,1,PAGE_SIZE,fp);
-		//updating to the current pointer position using ftell
-		fHandle->curPagePos=ftell(fp)/PAGE_SIZE; 
-		fclose(fp);              
-		return RC_OK;
-    }
-}
-
-
-//implementing function 2 getBlockPos (SM_FileHandle *fHandle)
-int getBlockPos (SM_FileHandle *fHandle)
-{
-	//In order to get the current page position in a file 
-	return fHandle->curPagePos;
-}
-
-
-//implementing function 3 readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{ 			
-	if (fHandle->mgmtInfo == NULL)
-		return RC_FILE_NOT_FOUND;
-    
-	// reading first block
-	readBlock(0, fHandle, memPage);
-
-   //use ftell to set current file position to curPagePos 
-    fHandle->curPagePos = ftell(fHandle->mgmtInfo)/PAGE_SIZE;
-	return RC_OK;
-}
-
-
-//implementing function 4 readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-    //check for Null
-    if (fopen(fHandle->fileName,"r")==NULL)
-		return RC_FILE_NOT_FOUND;
-
-	if (fHandle->curPagePos<=0)
-        return RC_READ_NON_EXISTING_PAGE;
-
-	int offset;
-    //defining offset
-    offset=fHandle->curPagePos-1;
-    //calling readBlock function
-    readBlock(offset,fHandle,memPage);
-
-   //use ftell to set current file position to curPagePos 
-    fHandle->curPagePos = ftell(fHandle->mgmtInfo)/PAGE_SIZE;	
-	return RC_OK;
-}
-
-
-//implementing function 5 readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-    //check for if File exists
-    if (fopen(fHandle->fileName,"r")==NULL)
-        return RC_FILE_NOT_FOUND;
-    
-    //check for invalid page number
-    if (fHandle->curPagePos>fHandle->totalNumPages-1)
-        return RC_READ_NON_EXISTING_PAGE;
-    
-    if (fHandle->curPagePos<0)
-        return RC_READ_NON_EXISTING_PAGE;
-	
-    //defining offset
-    int offset;
-    offset=fHandle->curPagePos;
-    //calling function 
-    readBlock(offset,fHandle,memPage);
-   //use ftell to set current file position to curPagePos 
-    fHandle->curPagePos = ftell(fHandle->mgmtInfo)/PAGE_SIZE;
-	return RC_OK;
-}
-
-
-
-//implementing function 6 readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-
-    //check for Null
-    if (fopen(fHandle->fileName,"r")==NULL)
-        return RC_FILE_NOT_FOUND;
-
-    //defining offset
-    int offset;
-    offset=fHandle->curPagePos + 1;
-
-    // calling function
-    readBlock(offset,fHandle,memPage);
-
-   //use ftell to set current file position to curPagePos 
-    fHandle->curPagePos = ftell(fHandle->mgmtInfo)/PAGE_SIZE;
-	return RC_OK;
-}
-
-
-//implementing function 7 readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-    //check for Null
-    if (fopen(fHandle->fileName,"r")==NULL)
-        return RC_FILE_NOT_FOUND;
-    
-    //defining offset
-    int offset;
-    offset=fHandle->totalNumPages - 1;
-    //calling function
-    readBlock(offset,fHandle,memPage);
-   //use ftell to set current file position to curPagePos 
-    fHandle->curPagePos = ftell(fHandle->mgmtInfo)/PAGE_SIZE;
-	return RC_OK;
-}
-
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-	if(fHandle->fileName==NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	int offset = pageNum * PAGE_SIZE;
-	fp=fopen(fHandle->fileName,"r+");
-	if(fp == NULL)//check if the write output withe the page is not 1 then throw an error saying the write failed
-	{
-		printf("Segmentation fault here\n");
-		return RC_FILE_NOT_FOUND;
-	}
-		
-	fseek(fp,offset,SEEK_SET);
- 	if(fwrite(memPage,PAGE_SIZE,1,fp) != 1)//check if the write output withe the page is not 1 then throw an error saying the write failed
-		return RC_WRITE_FAILED;
-
-	offset = fHandle->curPagePos*PAGE_SIZE;
-	//seeks to the particular page
-	fseek(fp,offset,SEEK_SET);
-	//returns the current pointer position of the file 
-    fHandle->curPagePos = ftell(fp)/PAGE_SIZE;
-    
- 	fseek(fp,(fHandle->curPagePos)*PAGE_SIZE , SEEK_SET);
- 	fHandle->mgmtInfo = fp;
-	//Close fp
-    fclose(fp);
-	//return success code
-    return RC_OK;
-}
-
-RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
-{
-	if(fHandle->fileName==NULL)
-		return RC_FILE_NOT_FOUND;
-	int offset;
-	offset = fHandle->curPagePos;
-	fp = fopen(fHandle->fileName,"r+");  // Open the file in read + write mode
-	fseek(fp, offset*PAGE_SIZE , SEEK_SET);
-	if(fwrite(memPage,PAGE_SIZE,1,fp) != 1)// writes the data from the buffer to the file
-		return RC_WRITE_FAILED;  // if output is -1 then its writing has failed 
-
-	// set the offset value which returns the current pointer of block.
- 	offset = (ftell(fHandle->mgmtInfo)/PAGE_SIZE);
-	// seeks the pointer and writes the data to file
- 	fseek(fp, offset*PAGE_SIZE , SEEK_SET);
- 	fHandle->mgmtInfo = fp;
-	fHandle->curPagePos = ftell(fp) / PAGE_SIZE; // Update current page position
-	fclose(fp);
-	// return success code
-    return RC_OK;
-}
-
-RC appendEmptyBlock (SM_FileHandle *fHandle)
-{
-	int i;
-	SM_PageHandle empty_page = (SM_PageHandle)malloc(sizeof(PAGE_SIZE));
-	fp = fopen(fHandle->fileName,"r");
-	if (fp == NULL)
-		return RC_FILE_NOT_FOUND;
-	fclose(fp);
-	
-	fp = fopen(fHandle->fileName,"a");  // Open the file in read + write mode
-
-	//writes data to the empty page
-	i = fwrite(empty_page, 1, PAGE_SIZE, fp);
-	if (i != PAGE_SIZE)
-		printf("%d\n",i);
-	fHandle->mgmtInfo = fp;
-	fHandle->totalNumPages = (ftell(fp)/PAGE_SIZE);
-	
-	fclose(fp);
-	//return success code
-	return RC_OK;
-}
-
-
-RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
-{
-	int offset;
-	fp = fopen(fHandle->fileName,"r+");
-	if(fp == NULL)
-		return RC_FILE_NOT_FOUND;
-	offset = fHandle->totalNumPages;
-	if (offset < numberOfPages) //Check if total number of pages is less than number of pages
-	{
-		while (offset != numberOfPages) 
-		{
-			appendEmptyBlock(fHandle); // based on the if clause append the empty block
-			offset += 1;
-		}
-	}
-	fclose(fp);
-	return RC_OK;
-}
\ No newline at end of file
+#define _GNU_SOURCE  // fallocate
+#include <stdlib.h>
+#include<stdio.h>
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "checksum.h"
+#include<string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <pthread.h>
+
+// Page files start with a header block that records their page size and options
+#define PAGE_FILE_MAGIC 0x31464750  // "PGF1"
+#define SM_MAX_IOV_PAGES 256  // pages moved by one preadv/pwritev, well under IOV_MAX
+typedef struct PageFileHeader {
+	unsigned int magic;
+	int pageSize;
+	int options;  // SM_PAGE_CHECKSUMS and SM_FREE_SPACE_MAP, zero in files written before options existed
+} PageFileHeader;
+
+
+// Fill in page size, header size and options from the header of an open page file
+static void readPageFileHeader (int fd, int *pageSize, int *headerSize, int *options)
+{
+	PageFileHeader header;
+	if (pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == PAGE_FILE_MAGIC)
+	{
+		*pageSize = header.pageSize;
+		*headerSize = PAGE_FILE_HEADER_SIZE;
+		*options = header.options;
+	}
+	else  // File written before page files had a header
+	{
+		*pageSize = PAGE_SIZE;
+		*headerSize = 0;
+		*options = 0;
+	}
+}
+
+
+// Byte offset of a page inside the page file
+static long pageOffset (SM_FileHandle *fHandle, int pageNum)
+{
+	return fHandle->headerSize + (long) pageNum * fHandle->pageSize;
+}
+
+
+// Page number at a byte offset inside the page file
+static int pageAtOffset (SM_FileHandle *fHandle, long offset)
+{
+	return (offset - fHandle->headerSize) / fHandle->pageSize;
+}
+
+
+/*
+ * Grow the file to hold numPages pages without writing them: ftruncate sets the new
+ * size and the pages read as zeros, which checksummed files accept as never written.
+ * Disk space is reserved a whole extent at a time past the end, so files grown a page
+ * at a time still end up in large contiguous runs. The file never shrinks here, in case
+ * another handle grew it further.
+ */
+static RC growPageFile (SM_FileHandle *fHandle, int numPages)
+{
+	struct stat st;
+	int fd = fHandle->fd;
+	if (fstat(fd, &st) != 0)
+		return RC_FILE_NOT_FOUND;
+	if (pageAtOffset(fHandle, st.st_size) >= numPages)  // long enough already
+	{
+		fHandle->totalNumPages = pageAtOffset(fHandle, st.st_size);
+		return RC_OK;
+	}
+	if (numPages > fHandle->allocatedPages)
+	{
+		int extent = fHandle->extentPages > 0 ? fHandle->extentPages : 1;
+		int reserve = (numPages + extent - 1) / extent * extent;
+#ifdef FALLOC_FL_KEEP_SIZE
+		// Best effort, file systems without fallocate just allocate on write
+		fallocate(fd, FALLOC_FL_KEEP_SIZE, st.st_size, pageOffset(fHandle, reserve) - st.st_size);
+#endif
+		fHandle->allocatedPages = reserve;
+	}
+	if (ftruncate(fd, pageOffset(fHandle, numPages)) != 0)
+		return RC_WRITE_FAILED;
+	fHandle->totalNumPages = numPages;
+	return RC_OK;
+}
+
+
+//function definitions
+extern void initStorageManager (void)
+{
+	printf("SM Storage Manager has been initialized\n");  // Initialize storage manager
+	return;
+}
+
+
+extern RC createPageFile (char *fileName)
+{
+	return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
+
+
+extern RC createPageFileWithPageSize (char *fileName, int pageSize)
+{
+	return createPageFileWithOptions(fileName, pageSize, 0);
+}
+
+
+extern RC createPageFileWithOptions (char *fileName, int pageSize, int options)
+{
+	FILE *fp;
+	// Page sizes are powers of two, so pages never straddle OS pages
+	if (pageSize < MIN_PAGE_SIZE || pageSize > MAX_PAGE_SIZE || (pageSize & (pageSize - 1)) != 0)
+		return RC_INVALID_PAGE_SIZE;
+
+	fp = fopen(fileName, "w");  // Create/Overwrite a file
+	if (fp == NULL)  
+	{
+		fclose(fp);
+		exit(1);  // Exit if there is an error creating the file
+	}
+	else
+	{
+		char *block = (char *) calloc(1, PAGE_FILE_HEADER_SIZE);
+		PageFileHeader header;
+		header.magic = PAGE_FILE_MAGIC;
+		header.pageSize = pageSize;
+		header.options = options;
+		memcpy(block, &header, sizeof(header));
+		fwrite(block, PAGE_FILE_HEADER_SIZE, 1, fp);  // Header block
+		free(block);
+		fflush(fp);
+		// Single page of 0 bytes, left to the file system to fill in
+		RC rc = (ftruncate(fileno(fp), PAGE_FILE_HEADER_SIZE + pageSize) == 0) ? RC_OK : RC_WRITE_FAILED;
+		fclose(fp);
+		return rc;  // Return success code
+	}
+}
+	
+
+extern RC openPageFile (char *fileName, SM_FileHandle *fHandle)
+{
+	struct stat st;
+	int fd = open(fileName, O_RDWR);  // Open in read + write mode and check if the file exists
+	if (fd < 0)
+		return RC_FILE_NOT_FOUND;  // Return corresponding error code
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return RC_FILE_NOT_FOUND;
+	}
+	else
+	{
+		int options;
+		// Update fHandle with file details
+		fHandle->fileName = fileName;  
+		readPageFileHeader(fd, &fHandle->pageSize, &fHandle->headerSize, &options);
+		fHandle->checksums = (options & SM_PAGE_CHECKSUMS) != 0;
+		fHandle->freeSpaceMap = (options & SM_FREE_SPACE_MAP) != 0;
+		fHandle->totalNumPages = pageAtOffset(fHandle, st.st_size);  // Get total number of pages and store it, it is kept up to date in memory from here on
+		fHandle->allocatedPages = fHandle->totalNumPages;
+		fHandle->extentPages = SM_DEFAULT_EXTENT_PAGES;
+		fHandle->curPagePos = 0;
+		fHandle->fd = fd;  // Kept open until closePageFile
+		fHandle->mgmtInfo = NULL;
+		return RC_OK;  // Return success code
+	}
+}
+
+
+extern RC closePageFile (SM_FileHandle *fHandle)
+{
+	if (fHandle->fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+	close(fHandle->fd);
+	fHandle->fd = -1;
+	return RC_OK;  // Return success code
+}
+
+
+extern RC destroyPageFile (char *fileName)
+{
+	FILE *fp;
+	fp = fopen(fileName, "r");  // Check if file exists
+	if (fp != NULL)
+	{
+		fclose(fp);
+		remove(fileName);  // Destroy the file
+		return RC_OK;
+	}
+	else
+		return RC_FILE_NOT_FOUND;
+}
+
+
+/*
+ * Move numPages consecutive pages between the file and the page buffers with
+ * preadv/pwritev, up to SM_MAX_IOV_PAGES pages per system call. A short transfer is
+ * picked up where it stopped; a read that hits the end of the file fails.
+ */
+static RC transferBlocks (int fd, SM_FileHandle *fHandle, int startPage, int numPages, SM_PageHandle *memPages, bool write)
+{
+	struct iovec iov[SM_MAX_IOV_PAGES];
+	int done = 0;
+	while (done < numPages)
+	{
+		int count = (numPages - done < SM_MAX_IOV_PAGES) ? numPages - done : SM_MAX_IOV_PAGES;
+		int i;
+		for (i = 0; i < count; i++)
+		{
+			iov[i].iov_base = memPages[done + i];
+			iov[i].iov_len = fHandle->pageSize;
+		}
+		ssize_t moved = write ? pwritev(fd, iov, count, pageOffset(fHandle, startPage + done))
+				: preadv(fd, iov, count, pageOffset(fHandle, startPage + done));
+		if (moved <= 0)
+			return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+		done += moved / fHandle->pageSize;
+		if (moved % fHandle->pageSize != 0)  // stopped inside a page: move the rest of it on its own
+		{
+			int part = moved % fHandle->pageSize;
+			char *rest = memPages[done] + part;
+			off_t at = pageOffset(fHandle, startPage + done) + part;
+			while (part < fHandle->pageSize)
+			{
+				moved = write ? pwrite(fd, rest, fHandle->pageSize - part, at) : pread(fd, rest, fHandle->pageSize - part, at);
+				if (moved <= 0)
+					return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+				part += moved;
+				rest += moved;
+				at += moved;
+			}
+			done++;
+		}
+	}
+	return RC_OK;
+}
+
+
+// Check the trailers of pages just read, the first damaged page decides the result
+static RC verifyBlocks (SM_FileHandle *fHandle, int numPages, SM_PageHandle *memPages)
+{
+	int i;
+	if (!fHandle->checksums)
+		return RC_OK;
+	for (i = 0; i < numPages; i++)
+	{
+		if (!verifyPageChecksum(memPages[i], fHandle->pageSize))
+			return RC_PAGE_CHECKSUM_MISMATCH;
+	}
+	return RC_OK;
+}
+
+
+//Implementing function 1 readBlock
+extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	return readBlocks(pageNum, 1, fHandle, &memPage);
+}
+
+
+// Read numPages consecutive pages into memPages[0..numPages-1] with as few reads as possible
+extern RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+	RC rc;
+	if (startPage < 0 || numPages < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	if (fHandle->fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+	rc = transferBlocks(fHandle->fd, fHandle, startPage, numPages, memPages, false);
+	if (rc != RC_OK)
+		return rc;
+	fHandle->curPagePos = startPage + numPages - 1;  // the last page read is the current one
+	//a torn or corrupted page doesn't match its trailer any more
+	return verifyBlocks(fHandle, numPages, memPages);
+}
+
+
+//implementing function 2 getBlockPos (SM_FileHandle *fHandle)
+int getBlockPos (SM_FileHandle *fHandle)
+{
+	//In order to get the current page position in a file 
+	return fHandle->curPagePos;
+}
+
+
+//implementing function 3 readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{ 			
+	if (fHandle->fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+	// reading first block, readBlock makes it the current one
+	return readBlock(0, fHandle, memPage);
+}
+
+
+//implementing function 4 readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	if (fHandle->curPagePos <= 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
+}
+
+
+//implementing function 5 readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	//check for invalid page number
+	if (fHandle->curPagePos < 0 || fHandle->curPagePos > fHandle->totalNumPages - 1)
+		return RC_READ_NON_EXISTING_PAGE;
+	return readBlock(fHandle->curPagePos, fHandle, memPage);
+}
+
+
+//implementing function 6 readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	if (fHandle->curPagePos + 1 > fHandle->totalNumPages - 1)
+		return RC_READ_NON_EXISTING_PAGE;
+	return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
+}
+
+
+//implementing function 7 readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	if (fHandle->totalNumPages <= 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
+
+
+extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	return writeBlocks(pageNum, 1, fHandle, &memPage);
+}
+
+
+// Write numPages consecutive pages from memPages[0..numPages-1], stamping their trailers first in checksummed files.
+// The pages must not change until the write is done, or the trailer on disk won't match them
+extern RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+	int i;
+	RC rc;
+	if (fHandle->fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (startPage < 0 || numPages < 0)
+		return RC_WRITE_FAILED;
+	if (fHandle->checksums)
+	{
+		for (i = 0; i < numPages; i++)
+			stampPageChecksum(memPages[i], fHandle->pageSize);
+	}
+	if (startPage + numPages > fHandle->totalNumPages)  // past the end: grow first, so the space comes in whole extents
+	{
+		rc = growPageFile(fHandle, startPage + numPages);
+		if (rc != RC_OK)
+			return rc;
+	}
+	return transferBlocks(fHandle->fd, fHandle, startPage, numPages, memPages, true);
+}
+
+RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+	if (fHandle->curPagePos < 0)
+		return RC_WRITE_FAILED;
+	return writeBlock(fHandle->curPagePos, fHandle, memPage);  // the page written stays the current one
+}
+
+RC appendEmptyBlock (SM_FileHandle *fHandle)
+{
+	return growPageFile(fHandle, fHandle->totalNumPages + 1);
+}
+
+
+RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
+{
+	if (fHandle->totalNumPages >= numberOfPages) //Check if total number of pages is less than number of pages
+		return RC_OK;
+	return growPageFile(fHandle, numberOfPages);  // all missing pages in one go
+}
+
+
+// Re-read the page count from the file size, for handles that may have missed growth by other handles
+RC refreshPageCount (SM_FileHandle *fHandle)
+{
+	struct stat st;
+	if (fstat(fHandle->fd, &st) != 0)
+		return RC_FILE_NOT_FOUND;
+	fHandle->totalNumPages = pageAtOffset(fHandle, st.st_size);
+	return RC_OK;
+}
+
+
+/*
+ * Files created with SM_FREE_SPACE_MAP keep a bitmap of the pages in use: page 0 is a
+ * map page with one bit for each of the next freeSpaceMapCapacity pages, the page after
+ * those is the next map page, and so on. A clear bit is a free page, so map pages past
+ * the end of the file, which read as zeros, mark all their pages free.
+ */
+extern int freeSpaceMapCapacity (SM_FileHandle *fHandle)
+{
+	return (fHandle->pageSize - (fHandle->checksums ? PAGE_CHECKSUM_SIZE : 0)) * 8;
+}
+
+
+// Map page tracking pageNum, with the bit for it there; bit is -1 when pageNum is a map page itself
+extern int freeSpaceMapPage (SM_FileHandle *fHandle, int pageNum, int *bit)
+{
+	int group = freeSpaceMapCapacity(fHandle) + 1;
+	*bit = pageNum % group - 1;
+	return pageNum - pageNum % group;
+}
+
+
+// Give the disk space of a page range back to the file system, the pages read as zeros afterwards
+extern RC punchBlocks (int startPage, int numPages, SM_FileHandle *fHandle)
+{
+	int fd = fHandle->fd;
+	if (startPage < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	if (startPage + numPages > fHandle->totalNumPages)  // nothing stored past the end
+		numPages = fHandle->totalNumPages - startPage;
+	if (numPages <= 0)
+		return RC_OK;
+#ifdef FALLOC_FL_PUNCH_HOLE
+	if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, pageOffset(fHandle, startPage), (off_t) numPages * fHandle->pageSize) == 0)
+		return RC_OK;
+#endif
+	// No hole punching here: the space stays in use, but the pages are zeroed all the same
+	char *zeros = (char *) calloc(1, fHandle->pageSize);
+	int i;
+	for (i = 0; i < numPages; i++)
+	{
+		if (pwrite(fd, zeros, fHandle->pageSize, pageOffset(fHandle, startPage + i)) != fHandle->pageSize)
+		{
+			free(zeros);
+			return RC_WRITE_FAILED;
+		}
+	}
+	free(zeros);
+	return RC_OK;
+}
+
+
+// Pages of disk space reserved at a time when the file grows
+RC setExtentPages (SM_FileHandle *fHandle, int numPages)
+{
+	if (numPages <= 0)
+		return RC_ERROR;
+	fHandle->extentPages = numPages;
+	return RC_OK;
+}
+
+/*
+ * A scan cursor streams a page range through two buffers of chunkPages pages: a reader
+ * thread fills one with a single large read while the caller works through the other,
+ * so the caller only waits when it is faster than the device.
+ */
+typedef struct ScanBuffer {
+	char *data;
+	int firstPage;
+	int numPages;  // pages read into data, 0 past the end of the scan
+	RC rc;
+	bool full;  // filled and not consumed yet, owned by the caller until then
+} ScanBuffer;
+
+typedef struct ScanState {
+	int fd;
+	int chunkPages;
+	ScanBuffer buffers[2];
+	int current;  // buffer the caller takes pages from
+	pthread_t reader;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;  // signalled when a buffer is filled or given back
+	bool stop;
+} ScanState;
+
+
+static void *scanReader (void *arg)
+{
+	SM_ScanCursor *cursor = (SM_ScanCursor *) arg;
+	ScanState *state = (ScanState *) cursor->mgmtInfo;
+	SM_FileHandle *fh = cursor->fHandle;
+	SM_PageHandle *pages = (SM_PageHandle *) malloc(sizeof(SM_PageHandle) * state->chunkPages);
+	int page = cursor->nextPage, b = 0;
+	bool done = false;
+
+	while (!done)
+	{
+		ScanBuffer *buf = &state->buffers[b];
+		pthread_mutex_lock(&state->lock);
+		while (buf->full && !state->stop)
+			pthread_cond_wait(&state->cond, &state->lock);
+		bool stop = state->stop;
+		pthread_mutex_unlock(&state->lock);
+		if (stop)
+			break;
+
+		int count = (cursor->endPage - page < state->chunkPages) ? cursor->endPage - page : state->chunkPages;
+		int i;
+		RC rc = RC_OK;
+		for (i = 0; i < count; i++)
+			pages[i] = buf->data + (size_t) i * fh->pageSize;
+		if (count > 0)
+		{
+			rc = transferBlocks(state->fd, fh, page, count, pages, false);
+			if (rc == RC_OK)
+				rc = verifyBlocks(fh, count, pages);
+		}
+		done = count == 0 || rc != RC_OK;  // the end of the range, or an error, is handed over like a chunk
+
+		pthread_mutex_lock(&state->lock);
+		buf->firstPage = page;
+		buf->numPages = count;
+		buf->rc = rc;
+		buf->full = true;
+		pthread_cond_broadcast(&state->cond);
+		pthread_mutex_unlock(&state->lock);
+		page += count;
+		b = 1 - b;
+	}
+	free(pages);
+	return NULL;
+}
+
+
+static void closeScanCursorState (ScanState *state)
+{
+	close(state->fd);
+	free(state->buffers[0].data);
+	free(state->buffers[1].data);
+	pthread_mutex_destroy(&state->lock);
+	pthread_cond_destroy(&state->cond);
+	free(state);
+}
+
+
+// Scan numPages pages from startPage on (clipped to the file), read chunkPages at a time, SM_DEFAULT_SCAN_CHUNK_PAGES if 0
+extern RC openScanCursor (SM_FileHandle *fHandle, int startPage, int numPages, int chunkPages, SM_ScanCursor *cursor)
+{
+	ScanState *state;
+	int b;
+	if (startPage < 0 || numPages < 0 || chunkPages < 0)
+		return RC_READ_NON_EXISTING_PAGE;
+	cursor->fHandle = fHandle;
+	cursor->nextPage = startPage;
+	cursor->endPage = (startPage + numPages < fHandle->totalNumPages) ? startPage + numPages : fHandle->totalNumPages;
+	if (cursor->endPage < startPage)
+		cursor->endPage = startPage;
+
+	state = (ScanState *) calloc(1, sizeof(ScanState));
+	state->fd = open(fHandle->fileName, O_RDONLY);
+	if (state->fd < 0)
+	{
+		free(state);
+		return RC_FILE_NOT_FOUND;
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(state->fd, pageOffset(fHandle, startPage), (off_t) (cursor->endPage - startPage) * fHandle->pageSize, POSIX_FADV_SEQUENTIAL);
+#endif
+	state->chunkPages = (chunkPages > 0) ? chunkPages : SM_DEFAULT_SCAN_CHUNK_PAGES;
+	for (b = 0; b < 2; b++)
+		state->buffers[b].data = (char *) malloc((size_t) state->chunkPages * fHandle->pageSize);
+	pthread_mutex_init(&state->lock, NULL);
+	pthread_cond_init(&state->cond, NULL);
+	cursor->mgmtInfo = state;
+	if (pthread_create(&state->reader, NULL, scanReader, cursor) != 0)
+	{
+		cursor->mgmtInfo = NULL;
+		closeScanCursorState(state);
+		return RC_ERROR;
+	}
+	return RC_OK;
+}
+
+
+// Point *memPage at the next page of the scan, valid until the next call; RC_READ_NON_EXISTING_PAGE once the range is done
+extern RC scanNextBlock (SM_ScanCursor *cursor, SM_PageHandle *memPage)
+{
+	ScanState *state = (ScanState *) cursor->mgmtInfo;
+	if (state == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	while (cursor->nextPage < cursor->endPage)
+	{
+		ScanBuffer *buf = &state->buffers[state->current];
+		pthread_mutex_lock(&state->lock);
+		while (!buf->full)
+			pthread_cond_wait(&state->cond, &state->lock);
+		pthread_mutex_unlock(&state->lock);
+		if (buf->rc != RC_OK)
+			return buf->rc;
+		if (cursor->nextPage < buf->firstPage + buf->numPages)
+		{
+			*memPage = buf->data + (size_t) (cursor->nextPage - buf->firstPage) * cursor->fHandle->pageSize;
+			cursor->fHandle->curPagePos = cursor->nextPage++;
+			return RC_OK;
+		}
+		if (buf->numPages == 0)
+			break;
+		pthread_mutex_lock(&state->lock);  // used up: the reader can fill it with the chunk after next
+		buf->full = false;
+		pthread_cond_broadcast(&state->cond);
+		pthread_mutex_unlock(&state->lock);
+		state->current = 1 - state->current;
+	}
+	return RC_READ_NON_EXISTING_PAGE;
+}
+
+
+extern RC closeScanCursor (SM_ScanCursor *cursor)
+{
+	ScanState *state = (ScanState *) cursor->mgmtInfo;
+	if (state == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	pthread_mutex_lock(&state->lock);
+	state->stop = true;
+	pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+	pthread_join(state->reader, NULL);
+	closeScanCursorState(state);
+	cursor->mgmtInfo = NULL;
+	return RC_OK;
+}
+
+
+extern RC openMappedPageFile (char *fileName, SM_MappedFile *mHandle)
+{
+	struct stat st;
+	int options;
+	FILE *file = fopen(fileName, "r");  // The mapping is read-only, so is the stream
+	if (file == NULL)
+		return RC_FILE_NOT_FOUND;
+	if (fstat(fileno(file), &st) != 0)
+	{
+		fclose(file);
+		return RC_FILE_NOT_FOUND;
+	}
+
+	mHandle->fileName = fileName;
+	readPageFileHeader(fileno(file), &mHandle->pageSize, &mHandle->headerSize, &options);
+	mHandle->checksums = (options & SM_PAGE_CHECKSUMS) != 0;
+	mHandle->totalNumPages = (st.st_size - mHandle->headerSize) / mHandle->pageSize;
+	mHandle->mapSize = mHandle->headerSize + (size_t) mHandle->totalNumPages * mHandle->pageSize;
+	mHandle->base = NULL;
+	if (mHandle->totalNumPages > 0)
+	{
+		void *base = mmap(NULL, mHandle->mapSize, PROT_READ, MAP_SHARED, fileno(file), 0);
+		if (base == MAP_FAILED)
+		{
+			fclose(file);
+			return RC_ERROR;
+		}
+		mHandle->base = (char *) base;
+	}
+	fclose(file);  // The mapping keeps its own reference to the file
+	return RC_OK;
+}
+
+
+extern RC closeMappedPageFile (SM_MappedFile *mHandle)
+{
+	if (mHandle->base != NULL)
+		munmap(mHandle->base, mHandle->mapSize);
+	mHandle->base = NULL;
+	mHandle->mapSize = 0;
+	mHandle->totalNumPages = 0;
+	return RC_OK;
+}
+
+
+// Point memPage straight at the page inside the mapping, nothing is copied
+extern RC mapBlock (int pageNum, SM_MappedFile *mHandle, SM_PageHandle *memPage)
+{
+	if (mHandle->base == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (pageNum < 0 || pageNum >= mHandle->totalNumPages)
+		return RC_READ_NON_EXISTING_PAGE;
+	*memPage = mHandle->base + mHandle->headerSize + (size_t) pageNum * mHandle->pageSize;
+	if (mHandle->checksums && !verifyPageChecksum(*memPage, mHandle->pageSize))
+		return RC_PAGE_CHECKSUM_MISMATCH;
+	return RC_OK;
+}
+
+
+extern RC adviseBlocks (int startPage, int numPages, SM_MappedFile *mHandle, SM_AccessAdvice advice)
+{
+	static const int madviseFlags[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED};
+	size_t osPage = (size_t) sysconf(_SC_PAGESIZE);
+	size_t start, end;
+
+	if (mHandle->base == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	// Clip the range to the mapping
+	if (startPage < 0)
+	{
+		numPages += startPage;
+		startPage = 0;
+	}
+	if (startPage + numPages > mHandle->totalNumPages)
+		numPages = mHandle->totalNumPages - startPage;
+	if (numPages <= 0)
+		return RC_OK;
+
+	start = mHandle->headerSize + (size_t) startPage * mHandle->pageSize;
+	end = start + (size_t) numPages * mHandle->pageSize;
+	start -= start % osPage;  // madvise wants an address aligned to the OS page size
+	if (madvise(mHandle->base + start, end - start, madviseFlags[advice]) != 0)
+		return RC_ERROR;
+	return RC_OK;
+}
@@ -2,6 +2,11 @@
 #define STORAGE_MGR_H
 
 #include "dberror.h"
+#include "dt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /************************************************************
  *                    handle data structures                *
@@ -10,17 +15,61 @@ typedef struct SM_FileHandle {
 	char *fileName;
 	int totalNumPages;
 	int curPagePos;
+	int pageSize;  // read from the page file header
+	int headerSize;  // bytes in front of page 0
+	bool checksums;  // pages end in a CRC32C trailer, stamped by writeBlock and checked by readBlock
+	bool freeSpaceMap;  // map pages track which pages are in use, see freeSpaceMapPage
+	int allocatedPages;  // pages of disk space reserved, the file grows into them without new allocations
+	int extentPages;  // pages reserved at a time when the file grows past allocatedPages
+	int fd;  // open from openPageFile to closePageFile, every read and write goes through it; copies of the handle share it
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+#define SM_DEFAULT_EXTENT_PAGES 64
+#define SM_DEFAULT_SCAN_CHUNK_PAGES 256  // pages per read of a scan cursor, 1MB of 4KB pages
+
+// Streams a page range through large reads done ahead of the caller, see openScanCursor
+typedef struct SM_ScanCursor {
+	SM_FileHandle *fHandle;
+	int nextPage;  // page the next scanNextBlock returns
+	int endPage;  // first page past the scan
+	void *mgmtInfo;
+} SM_ScanCursor;
+
+// Options of createPageFileWithOptions
+#define SM_PAGE_CHECKSUMS 1  // reserve the last PAGE_CHECKSUM_SIZE bytes of every page for a checksum
+#define SM_FREE_SPACE_MAP 2  // keep a bitmap of the pages in use in map pages spread through the file
+
+// Read-only memory mapping of a page file, used to serve pages without copying them
+typedef struct SM_MappedFile {
+	char *fileName;
+	int totalNumPages;
+	int pageSize;
+	int headerSize;
+	bool checksums;
+	char *base;  // start of the mapping, NULL for an empty file
+	size_t mapSize;
+} SM_MappedFile;
+
+// Access pattern hints passed on to the kernel for a mapped page range
+typedef enum SM_AccessAdvice {
+	SM_ADVICE_NORMAL = 0,
+	SM_ADVICE_SEQUENTIAL = 1,
+	SM_ADVICE_RANDOM = 2,
+	SM_ADVICE_WILLNEED = 3,
+	SM_ADVICE_DONTNEED = 4
+} SM_AccessAdvice;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
+extern RC createPageFileWithOptions (char *fileName, int pageSize, int options);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
@@ -33,11 +82,35 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+
+/* streaming a page range */
+extern RC openScanCursor (SM_FileHandle *fHandle, int startPage, int numPages, int chunkPages, SM_ScanCursor *cursor);
+extern RC scanNextBlock (SM_ScanCursor *cursor, SM_PageHandle *memPage);
+extern RC closeScanCursor (SM_ScanCursor *cursor);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC setExtentPages (SM_FileHandle *fHandle, int numPages);
+extern RC refreshPageCount (SM_FileHandle *fHandle);
+
+/* free-space map of files created with SM_FREE_SPACE_MAP */
+extern int freeSpaceMapCapacity (SM_FileHandle *fHandle);
+extern int freeSpaceMapPage (SM_FileHandle *fHandle, int pageNum, int *bit);
+extern RC punchBlocks (int startPage, int numPages, SM_FileHandle *fHandle);
+
+/* memory mapped access to a page file */
+extern RC openMappedPageFile (char *fileName, SM_MappedFile *mHandle);
+extern RC closeMappedPageFile (SM_MappedFile *mHandle);
+extern RC mapBlock (int pageNum, SM_MappedFile *mHandle, SM_PageHandle *memPage);
+extern RC adviseBlocks (int startPage, int numPages, SM_MappedFile *mHandle, SM_AccessAdvice advice);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
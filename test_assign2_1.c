@@ -3,11 +3,18 @@
 #include "buffer_mgr.h"
 #include "dberror.h"
 #include "test_helper.h"
+#include "compressed_tier.h"
+#include "checksum.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 
 // var to store the current test's name
 char *testName;
@@ -39,6 +46,33 @@ static void testFIFO (void);
 static void testLRU (void);
 static void testClock(void);
 static void testLFU(void);
+static void testReadOnlyPool(void);
+static void testPageSizes(void);
+static void testCompressedTier(void);
+static void testL2Cache(void);
+static void testWriteAheadLog(void);
+static void testCheckpoint(void);
+static void testChecksums(void);
+static void testWarmUp(void);
+static void testResize(void);
+static void testMultiFile(void);
+static void testFileGrowth(void);
+static void testLazyZeroPages(void);
+static void testFreeSpaceMap(void);
+static void testVectoredIO(void);
+static void testAsyncPin(void);
+static void testLatches(void);
+static void testOptimisticReads(void);
+static void testBackgroundEvictor(void);
+static void testPinWait(void);
+static void testFrameLookup(void);
+static void testCustomPolicy(void);
+static void testCleanFirst(void);
+static void testPinHints(void);
+static void testTenants(void);
+static void testFailedWriteBack(void);
+static void testFailedLogWrite(void);
+static void testPinnedPageNotReplaced(void);
 
 // main method
 int main (void)
@@ -51,6 +85,33 @@ int main (void)
   testLRU();
   testClock();
   testLFU();
+  testReadOnlyPool();
+  testPageSizes();
+  testCompressedTier();
+  testL2Cache();
+  testWriteAheadLog();
+  testCheckpoint();
+  testChecksums();
+  testWarmUp();
+  testResize();
+  testMultiFile();
+  testFileGrowth();
+  testLazyZeroPages();
+  testFreeSpaceMap();
+  testVectoredIO();
+  testAsyncPin();
+  testLatches();
+  testOptimisticReads();
+  testBackgroundEvictor();
+  testPinWait();
+  testFrameLookup();
+  testCustomPolicy();
+  testCleanFirst();
+  testPinHints();
+  testTenants();
+  testFailedWriteBack();
+  testFailedLogWrite();
+  testPinnedPageNotReplaced();
 }
 
 // create n pages with content "Page X" and read them back to check whether the content is right
@@ -431,3 +492,2065 @@ void testLFU(void)
     free(h);
     TEST_DONE();
 }
+
+// read pages through a pool that maps the page file instead of copying it
+void testReadOnlyPool(void)
+{
+  const char *poolContents[] = {
+    "[0 1],[-1 0],[-1 0]",
+    "[0 1],[1 0],[-1 0]",
+    "[0 1],[1 0],[2 0]",
+    "[0 1],[3 0],[2 0]"
+  };
+  int i;
+  char *expected = malloc(sizeof(char) * 512);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *root = MAKE_PAGE_HANDLE();
+  testName = "Testing read-only mapped pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPoolReadOnly(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  // keep page 0 pinned while the other frames cycle
+  CHECK(pinPage(bm, root, 0));
+  ASSERT_EQUALS_POOL(poolContents[0], bm, "pin first page");
+  for (i = 1; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "reading page through the mapping");
+      CHECK(unpinPage(bm, h));
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+  }
+  ASSERT_EQUALS_STRING("Page-0", root->data, "pinned page still valid");
+  ASSERT_ERROR(markDirty(bm, root), "pages of a read-only pool can't be dirtied");
+  ASSERT_ERROR(pinPage(bm, h, 20), "no appending to a read-only pool");
+  CHECK(unpinPage(bm, root));
+
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "check number of read I/Os");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(bm);
+  free(h);
+  free(root);
+  TEST_DONE();
+}
+
+// pools over page files with different page sizes side by side
+void testPageSizes(void)
+{
+  int i;
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  BM_BufferPool *small = MAKE_POOL();
+  BM_BufferPool *large = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing pools with different page sizes";
+
+  ASSERT_ERROR(createPageFileWithPageSize("testbuffer_large.bin", 3000), "page size must be a power of two");
+  ASSERT_ERROR(createPageFileWithPageSize("testbuffer_large.bin", 2 * MAX_PAGE_SIZE), "page size too large");
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(createPageFileWithPageSize("testbuffer_large.bin", 32768));
+
+  CHECK(initBufferPool(small, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(initBufferPool(large, "testbuffer_large.bin", 3, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(PAGE_SIZE, small->pageSize, "default page size");
+  ASSERT_EQUALS_INT(32768, large->pageSize, "page size read from the header");
+
+  // write a marker at the end of each large page, cycling through the pool
+  for (i = 0; i < 5; i++)
+  {
+      CHECK(pinPage(large, h, i));
+      sprintf(h->data + 32768 - 16, "%s-%d", "Tail", i);
+      CHECK(markDirty(large, h));
+      CHECK(unpinPage(large, h));
+      CHECK(pinPage(small, h, i));
+      sprintf(h->data, "%s-%d", "Page", i);
+      CHECK(markDirty(small, h));
+      CHECK(unpinPage(small, h));
+  }
+  CHECK(shutdownBufferPool(large));
+  CHECK(shutdownBufferPool(small));
+
+  CHECK(openPageFile("testbuffer_large.bin", &fh));
+  ASSERT_EQUALS_INT(32768, fh.pageSize, "page size of reopened file");
+  ASSERT_EQUALS_INT(5, fh.totalNumPages, "large file grew page by page");
+  ph = (SM_PageHandle) malloc(fh.pageSize);
+  CHECK(readBlock(4, &fh, ph));
+  ASSERT_EQUALS_STRING("Tail-4", ph + 32768 - 16, "marker at the end of a large page");
+  CHECK(closePageFile(&fh));
+  checkDummyPages(small, 5);
+
+  CHECK(destroyPageFile("testbuffer_large.bin"));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(small);
+  free(large);
+  free(h);
+  TEST_DONE();
+}
+
+// evicted clean pages come back from the compressed tier instead of the page file
+void testCompressedTier(void)
+{
+  int i, pass, size;
+  char *expected = malloc(sizeof(char) * 512);
+  char *text = malloc(PAGE_SIZE);
+  char *packed = malloc(lzCompressBound(PAGE_SIZE));
+  char *unpacked = malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing compressed victim tier";
+
+  // round trip through the compressor
+  for (i = 0; i < PAGE_SIZE; i++)
+      text[i] = "the quick brown fox jumps over the lazy dog "[(i * 7) % 44];
+  size = lzCompress(text, PAGE_SIZE, packed, lzCompressBound(PAGE_SIZE));
+  ASSERT_TRUE(size > 0 && size < PAGE_SIZE / 3, "text page compresses");
+  ASSERT_EQUALS_INT(PAGE_SIZE, lzDecompress(packed, size, unpacked, PAGE_SIZE), "decompressed size");
+  ASSERT_TRUE(memcmp(text, unpacked, PAGE_SIZE) == 0, "decompressed content");
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(setCompressedTierSize(bm, 16 * 1024));
+
+  // the second pass finds every evicted page in the tier
+  for (pass = 0; pass < 2; pass++)
+  {
+      for (i = 0; i < 10; i++)
+      {
+          CHECK(pinPage(bm, h, i));
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data, "page content");
+          CHECK(unpinPage(bm, h));
+      }
+  }
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "only the first pass reads the page file");
+  ASSERT_EQUALS_INT(10, getNumTierHits(bm), "second pass hits the tier");
+
+  // a dirtied page is written back before it reaches the tier
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s-%i", "Changed", 0);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  for (i = 1; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Changed-0", h->data, "modified page from the tier");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "still no extra reads");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "modified page written once");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(text);
+  free(packed);
+  free(unpacked);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// misses are served from a second local file before the page file
+void testL2Cache(void)
+{
+  int i, pass;
+  char *expected = malloc(sizeof(char) * 512);
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing L2 cache file";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(attachL2Cache(bm, "testbuffer.l2", 16));
+
+  for (pass = 0; pass < 2; pass++)
+  {
+      for (i = 0; i < 10; i++)
+      {
+          CHECK(pinPage(bm, h, i));
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data, "page content");
+          CHECK(unpinPage(bm, h));
+      }
+  }
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "only the first pass reads the page file");
+  ASSERT_EQUALS_INT(10, getNumL2Hits(bm), "second pass hits the L2 cache");
+
+  // modified pages are written to the page file, the L2 copy follows
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s-%i", "Changed", 0);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(forcePage(bm, h));
+  for (i = 1; i < 4; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+  }
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Changed-0", h->data, "modified page from the L2 cache");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "still no extra reads");
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(0, &fh, ph));
+  ASSERT_EQUALS_STRING("Changed-0", ph, "page file has the modified page");
+  CHECK(closePageFile(&fh));
+
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_ERROR(destroyPageFile("testbuffer.l2"), "cache file removed at shutdown");
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// committer thread for the group commit test
+static void *commitWorker(void *arg)
+{
+  WAL_Log *log = (WAL_Log *) arg;
+  LSN lsn;
+  int i;
+  for (i = 0; i < 20; i++)
+    {
+      appendLogRecord(log, WAL_PAGE_UPDATE, 1, 0, 7, "Grouped", &lsn);
+      commitLog(log, &lsn);
+    }
+  return NULL;
+}
+
+// page updates are logged and committed before pages are written, and can be replayed
+void testWriteAheadLog(void)
+{
+  int i, applied;
+  LSN lsn;
+  pthread_t workers[8];
+  WAL_Log *log;
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing write-ahead log";
+
+  remove("testbuffer.log");
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(openLog("testbuffer.log", &log));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(attachLog(bm, log));
+
+  // commit an update while the page stays in the pool
+  CHECK(pinPage(bm, h, 2));
+  sprintf(h->data, "%s-%i", "Logged", 2);
+  CHECK(logPageUpdate(bm, h, 0, strlen(h->data) + 1, &lsn));
+  ASSERT_TRUE(log->flushedLSN < lsn, "update not durable before commit");
+  CHECK(commitLog(log, &lsn));
+  ASSERT_TRUE(log->flushedLSN >= lsn, "commit makes the log durable");
+  CHECK(unpinPage(bm, h));
+
+  // the page file still has the old page, replaying the log brings the update back
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(2, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-2", ph, "page not written at commit");
+  CHECK(replayLog("testbuffer.log", "testbuffer.bin", NO_LSN, &applied));
+  ASSERT_EQUALS_INT(1, applied, "one update replayed");
+  CHECK(readBlock(2, &fh, ph));
+  ASSERT_EQUALS_STRING("Logged-2", ph, "update redone from the log");
+
+  // the log is flushed past the page before an evicted page is written
+  CHECK(pinPage(bm, h, 3));
+  sprintf(h->data, "%s-%i", "Evicted", 3);
+  CHECK(logPageUpdate(bm, h, 0, strlen(h->data) + 1, &lsn));
+  CHECK(unpinPage(bm, h));
+  for (i = 4; i < 7; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_TRUE(log->flushedLSN >= lsn, "log forced before page write");
+  CHECK(readBlock(3, &fh, ph));
+  ASSERT_EQUALS_STRING("Evicted-3", ph, "evicted page written");
+  CHECK(closePageFile(&fh));
+
+  // concurrent committers share fsyncs
+  setGroupCommitDelay(log, 1000);
+  int flushesBefore = log->numFlushes;
+  for (i = 0; i < 8; i++)
+      pthread_create(&workers[i], NULL, commitWorker, log);
+  for (i = 0; i < 8; i++)
+      pthread_join(workers[i], NULL);
+  ASSERT_EQUALS_INT(161, log->numCommits, "every commit done");
+  ASSERT_TRUE(log->numFlushes - flushesBefore < 160, "commits grouped into fewer fsyncs");
+  ASSERT_TRUE(log->flushedLSN == log->nextLSN, "whole log durable");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(closeLog(log));
+  CHECK(destroyPageFile("testbuffer.log"));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a checkpoint writes dirty pages while others stay pinned, and recovery starts at its redo LSN
+void testCheckpoint(void)
+{
+  int i, applied;
+  LSN lsn, redo;
+  WAL_Log *log;
+  SM_FileHandle fh;
+  BM_CheckpointStatus status;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  testName = "Testing fuzzy checkpoints";
+
+  remove("testbuffer.log");
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(openLog("testbuffer.log", &log));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+  CHECK(attachLog(bm, log));
+
+  // dirty four pages, keep the first one pinned
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Checkpointed", i);
+      CHECK(logPageUpdate(bm, h, 0, strlen(h->data) + 1, &lsn));
+      if (i == 0)
+        *pinned = *h;
+      else
+        CHECK(unpinPage(bm, h));
+    }
+  CHECK(commitLog(log, &lsn));
+  ASSERT_EQUALS_INT(RC_BUFFER_IN_USE_BY_CLIENT, forceFlushPool(bm), "flush refused while a page is pinned");
+
+  CHECK(getCheckpointStatus(bm, &status));
+  ASSERT_EQUALS_INT(4, status.numDirtyPages, "four dirty pages");
+  ASSERT_TRUE(status.oldestDirtyLSN == 0, "oldest dirty page goes back to the log start");
+
+  // step through a checkpoint by hand
+  CHECK(beginCheckpoint(bm));
+  ASSERT_EQUALS_INT(RC_CHECKPOINT_IN_PROGRESS, beginCheckpoint(bm), "one checkpoint at a time");
+  CHECK(checkpointStep(bm, 2));
+  CHECK(getCheckpointStatus(bm, &status));
+  ASSERT_TRUE(status.active, "checkpoint still running");
+  ASSERT_EQUALS_INT(4, status.numPages, "dirty page table has four pages");
+  ASSERT_EQUALS_INT(2, status.pagesDone, "two pages done");
+  ASSERT_EQUALS_INT(3, status.numDirtyPages, "two pages left dirty, and the pinned one written from a copy");
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(0, &fh, ph));
+  ASSERT_EQUALS_STRING("Checkpointed-0", ph, "pinned page written by the checkpoint");
+
+  // pages dirtied during the checkpoint don't hold it up
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s-%i", "AfterBegin", 0);
+  CHECK(logPageUpdate(bm, h, 0, strlen(h->data) + 1, &lsn));
+  CHECK(unpinPage(bm, h));
+  CHECK(waitForCheckpoint(bm));
+  CHECK(getCheckpointStatus(bm, &status));
+  ASSERT_TRUE(!status.active, "checkpoint complete");
+  ASSERT_EQUALS_INT(4, status.pagesDone, "every page handled");
+  ASSERT_EQUALS_INT(1, status.numDirtyPages, "only the page dirtied later is dirty");
+  ASSERT_TRUE(status.redoLSN == status.beginLSN, "redo starts at the checkpoint");
+  ASSERT_TRUE(status.oldestDirtyLSN >= status.redoLSN, "redo covers the dirty page");
+  ASSERT_TRUE(log->flushedLSN == log->nextLSN, "checkpoint end is durable");
+
+  CHECK(readBlock(3, &fh, ph));
+  ASSERT_EQUALS_STRING("Checkpointed-3", ph, "last page written");
+
+  // recovery from the checkpoint only redoes the update made after it began
+  CHECK(findCheckpointRedoLSN("testbuffer.log", &redo));
+  ASSERT_TRUE(redo == status.redoLSN, "redo LSN found in the log");
+  CHECK(commitLog(log, &lsn));
+  CHECK(replayLog("testbuffer.log", "testbuffer.bin", redo, &applied));
+  ASSERT_EQUALS_INT(1, applied, "one update after the checkpoint");
+  CHECK(readBlock(0, &fh, ph));
+  ASSERT_EQUALS_STRING("AfterBegin-0", ph, "later update redone");
+
+  // a background checkpoint trickles pages out while the pool keeps serving pins
+  for (i = 4; i < 7; i++)
+    {
+      CHECK(unpinPage(bm, pinned));
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Background", i);
+      CHECK(logPageUpdate(bm, h, 0, strlen(h->data) + 1, &lsn));
+      *pinned = *h;
+    }
+  CHECK(startCheckpoint(bm, 200));
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+  CHECK(waitForCheckpoint(bm));
+  CHECK(getCheckpointStatus(bm, &status));
+  ASSERT_TRUE(!status.active, "background checkpoint complete");
+  ASSERT_EQUALS_INT(1, status.numDirtyPages, "only the pinned page left dirty");
+  CHECK(readBlock(6, &fh, ph));
+  ASSERT_EQUALS_STRING("Background-6", ph, "pinned page written in the background");
+
+  // its client goes on changing it after the checkpoint, the change still reaches the file
+  sprintf(pinned->data, "%s-%i", "Changed", 6);
+  CHECK(unpinPage(bm, pinned));
+  CHECK(forceFlushPool(bm));
+  CHECK(readBlock(6, &fh, ph));
+  ASSERT_EQUALS_STRING("Changed-6", ph, "change after the checkpoint written");
+  CHECK(closePageFile(&fh));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(closeLog(log));
+  CHECK(destroyPageFile("testbuffer.log"));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// checksummed page files detect a damaged page on every pinPage miss
+void testChecksums(void)
+{
+  int i;
+  uint32_t trailer;
+  FILE *file;
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  char data[1100];
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing page checksums";
+
+  // hardware and portable CRC32C agree, at any length and alignment
+  ASSERT_TRUE(crc32c(0, "123456789", 9) == 0xE3069283, "CRC32C check value");
+  ASSERT_TRUE(crc32cPortable(0, "123456789", 9) == 0xE3069283, "portable CRC32C check value");
+  for (i = 0; i < (int) sizeof(data); i++)
+    data[i] = (char) (i * 7 + 3);
+  for (i = 0; i < 1000; i += 37)
+    ASSERT_TRUE(crc32c(0, data + i % 8, i) == crc32cPortable(0, data + i % 8, i), "CRC32C implementations agree");
+  ASSERT_TRUE(crc32c(crc32c(0, data, 600), data + 600, 400) == crc32c(0, data, 1000), "CRC32C continues over pieces");
+
+  // pages are stamped when they are written back
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_PAGE_CHECKSUMS));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Summed", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  // damage a byte of page 1
+  file = fopen("testbuffer.bin", "r+");
+  fseek(file, PAGE_FILE_HEADER_SIZE + PAGE_SIZE + 100, SEEK_SET);
+  fputc('X', file);
+  fclose(file);
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_TRUE(fh.checksums, "file has checksums");
+  CHECK(readBlock(2, &fh, ph));
+  ASSERT_EQUALS_STRING("Summed-2", ph, "intact page reads fine");
+  ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, readBlock(1, &fh, ph), "readBlock finds the damaged page");
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Summed-0", h->data, "intact page pinned");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, pinPage(bm, h, 1), "pinPage refuses the damaged page");
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // pages added to the file but never written pass as well
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(6, &fh));
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPoolReadOnly(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  ASSERT_EQUALS_INT(RC_PAGE_CHECKSUM_MISMATCH, pinPage(bm, h, 1), "mapped page checked as well");
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // checkpoints write pinned pages, which their clients may be changing: the trailer is stamped into a copy, not
+  // into the client's buffer, so the page on disk always matches it
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_PAGE_CHECKSUMS));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s-%i", "Pinned", 0);
+  CHECK(markDirty(bm, h));
+  CHECK(beginCheckpoint(bm));
+  CHECK(checkpointStep(bm, 1));
+  memcpy(&trailer, h->data + PAGE_SIZE - PAGE_CHECKSUM_SIZE, PAGE_CHECKSUM_SIZE);
+  ASSERT_TRUE(trailer == 0, "pinned buffer left alone");
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(0, &fh, ph));
+  ASSERT_EQUALS_STRING("Pinned-0", ph, "written with a matching trailer");
+  CHECK(closePageFile(&fh));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// the hottest resident pages are saved at shutdown and preloaded by the next pool
+void testWarmUp(void)
+{
+  int i, count;
+  PageNumber saved[8];
+  unsigned int magic;
+  FILE *file;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing pool warm-up";
+
+  remove("testbuffer.bin.warm");
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+
+  // pages 5 and 3 were used last, 1 is the coldest
+  CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(RC_FILE_NOT_FOUND, warmUpBufferPool(bm, false), "no warm list yet");
+  CHECK(enableWarmList(bm, 0));
+  for (i = 1; i <= 5; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 3));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPage(bm, h, 5));
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  file = fopen("testbuffer.bin.warm", "r");
+  ASSERT_TRUE(file != NULL, "warm list saved at shutdown");
+  ASSERT_TRUE(fread(&magic, sizeof(magic), 1, file) == 1 && fread(&count, sizeof(count), 1, file) == 1, "warm list header");
+  ASSERT_EQUALS_INT(5, count, "every resident page listed");
+  ASSERT_TRUE(fread(saved, sizeof(PageNumber), count, file) == (size_t) count, "warm list pages");
+  fclose(file);
+  ASSERT_EQUALS_INT(5, saved[0], "hottest page first");
+  ASSERT_EQUALS_INT(3, saved[1], "second hottest page next");
+  ASSERT_EQUALS_INT(1, saved[4], "coldest page last");
+
+  // a smaller pool takes the three hottest pages, before serving any pin
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(warmUpBufferPool(bm, false));
+  ASSERT_EQUALS_INT(3, getNumWarmedPages(bm), "three pages preloaded");
+  ASSERT_EQUALS_INT(3, getNumReadIO(bm), "one read per preloaded page");
+  ASSERT_EQUALS_POOL("[4 0],[3 0],[5 0]", bm, "hottest pages resident");
+  CHECK(pinPage(bm, h, 5));
+  ASSERT_EQUALS_STRING("Page-5", h->data, "preloaded page content");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(3, getNumReadIO(bm), "pin after warm-up is a hit");
+  CHECK(shutdownBufferPool(bm));
+
+  // warm-up in the background while pins are served, with the list saved by a timer
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  CHECK(warmUpBufferPool(bm, true));
+  CHECK(pinPage(bm, h, 12));
+  CHECK(unpinPage(bm, h));
+  CHECK(waitForWarmUp(bm));
+  ASSERT_TRUE(getNumWarmedPages(bm) >= 2, "pages preloaded around the pin");
+  CHECK(enableWarmList(bm, 20));
+  usleep(100000);
+  file = fopen("testbuffer.bin.warm", "r");
+  ASSERT_TRUE(fread(&magic, sizeof(magic), 1, file) == 1 && fread(&count, sizeof(count), 1, file) == 1, "warm list header");
+  ASSERT_TRUE(fread(saved, sizeof(PageNumber), count, file) == (size_t) count, "warm list pages");
+  fclose(file);
+  for (i = 0; i < count && saved[i] != 12; i++)
+    ;
+  ASSERT_TRUE(i < count, "timer saved the list with the new page");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin.warm"));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pools grow and shrink while in use, and a broker moves frames to the pool that gains the most
+void testResize(void)
+{
+  int i, round, gain, loss, moved, readIO;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_BufferPool *other = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  BM_MemoryBroker *broker;
+  testName = "Testing pool resizing";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+
+  // grow: the cached pages stay, the new frames are used before anything is evicted
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(resizeBufferPool(bm, 5));
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[-1 0],[-1 0]", bm, "pages kept when growing");
+  for (i = 3; i < 5; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0]", bm, "new frames filled");
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "no page evicted");
+
+  // shrink: the coldest unpinned pages go, pinned and dirty pages are moved
+  CHECK(pinPage(bm, pinned, 4));
+  CHECK(pinPage(bm, h, 2));
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(resizeBufferPool(bm, 2));
+  ASSERT_EQUALS_POOL("[2x0],[4 1]", bm, "hottest pages kept when shrinking");
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_EQUALS_INT(RC_BUFFER_IN_USE_BY_CLIENT, resizeBufferPool(bm, 1), "pinned pages are never evicted");
+  CHECK(unpinPage(bm, h));
+  CHECK(resizeBufferPool(bm, 1));
+  ASSERT_EQUALS_POOL("[4 1]", bm, "dirty page evicted");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty page written when evicted");
+  CHECK(unpinPage(bm, pinned));
+
+  // LRU goes on working on the resized pool
+  CHECK(resizeBufferPool(bm, 3));
+  for (i = 6; i < 9; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[8 0],[6 0],[7 0]", bm, "least recently used page replaced");
+  CHECK(shutdownBufferPool(bm));
+
+  // a pool scanning six pages in four frames gains from frames that a pool hitting one page doesn't need
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  CHECK(initBufferPool(other, "testbuffer.bin", 4, RS_LRU, NULL));
+  broker = createMemoryBroker(2, 2);
+  CHECK(brokerAddPool(broker, bm));
+  CHECK(brokerAddPool(broker, other));
+  for (round = 0; round < 3; round++)
+    for (i = 0; i < 6; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+        CHECK(pinPage(other, h, 0));
+        CHECK(unpinPage(other, h));
+      }
+  CHECK(getMarginalHits(bm, 2, &gain, &loss));
+  ASSERT_TRUE(gain > 0, "scanning pool would gain hits");
+  CHECK(getMarginalHits(other, 2, &gain, &loss));
+  ASSERT_EQUALS_INT(0, loss, "other pool loses nothing with fewer frames");
+  CHECK(rebalanceMemory(broker, &moved));
+  ASSERT_EQUALS_INT(2, moved, "two frames moved");
+  ASSERT_EQUALS_INT(6, bm->numPages, "scanning pool grown");
+  ASSERT_EQUALS_INT(2, other->numPages, "other pool shrunk");
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  readIO = getNumReadIO(bm);
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "scan fits in the grown pool");
+  CHECK(rebalanceMemory(broker, &moved));
+  ASSERT_EQUALS_INT(0, moved, "nothing to gain without misses");
+  destroyMemoryBroker(broker);
+  CHECK(shutdownBufferPool(bm));
+  CHECK(shutdownBufferPool(other));
+
+  // FIFO keeps its order across a shrink that moves the pages behind the hand
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_FIFO, NULL));
+  for (i = 0; i < 7; i++) // pages 4 to 6 replace 0 to 2, page 3 is the oldest
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, pinned, 3));
+  CHECK(resizeBufferPool(bm, 3)); // page 4 goes, pages 5, 6 and 3 move down a frame
+  ASSERT_EQUALS_POOL("[5 0],[6 0],[3 1]", bm, "oldest unpinned page evicted");
+  CHECK(unpinPage(bm, pinned));
+  CHECK(pinPage(bm, h, 7));
+  ASSERT_EQUALS_POOL("[5 0],[6 0],[7 1]", bm, "oldest page replaced after the shrink");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // each pool's clock hand stays within its own frames, however far another pool's goes
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_CLOCK, NULL));
+  CHECK(initBufferPool(other, "testbuffer.bin", 4, RS_CLOCK, NULL));
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(resizeBufferPool(other, 64));
+  for (i = 0; i < 20; i++)
+    {
+      CHECK(pinPage(other, h, i));
+      CHECK(unpinPage(other, h));
+    }
+  CHECK(pinPage(bm, h, 4));
+  ASSERT_EQUALS_POOL("[4 1],[1 0],[2 0],[3 0]", bm, "hand went round its own pool");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(shutdownBufferPool(other));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(other);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+
+// one pool caching pages of two page files
+void testMultiFile(void)
+{
+  int i, other, again, *fileIds;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  testName = "Testing a pool shared by several page files";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(createPageFile("testbuffer2.bin"));
+  CHECK(createPageFileWithPageSize("testbuffer3.bin", 2 * PAGE_SIZE));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  CHECK(registerPageFile(bm, "testbuffer2.bin", &other));
+  ASSERT_EQUALS_INT(1, other, "second file gets id 1");
+  CHECK(registerPageFile(bm, "testbuffer2.bin", &again));
+  ASSERT_EQUALS_INT(other, again, "registering again returns the same id");
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, registerPageFile(bm, "testbuffer3.bin", &again), "page sizes must match");
+  ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, pinFilePage(bm, h, 5, 0), "unknown file id");
+
+  // the same page number in two files lives in two frames
+  CHECK(pinPage(bm, h, 1));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinFilePage(bm, h, other, 1));
+  ASSERT_EQUALS_INT(other, h->fileId, "handle carries the file");
+  sprintf(h->data, "%s-%d", "Other", h->pageNum);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[1 0],[1x0],[-1 0],[-1 0]", bm, "page 1 of both files cached");
+  CHECK(pinPage(bm, h, 1));
+  ASSERT_EQUALS_STRING("Page-1", h->data, "own file's page unchanged");
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+
+  // a file at its quota replaces its own pages and leaves the others alone
+  CHECK(setFileQuota(bm, other, 2));
+  for (i = 2; i < 8; i++)
+    {
+      CHECK(pinFilePage(bm, h, other, i));
+      CHECK(unpinPage(bm, h));
+    }
+  fileIds = getFrameFileIds(bm);
+  ASSERT_EQUALS_INT(0, fileIds[0], "own page kept");
+  ASSERT_EQUALS_INT(other, fileIds[1], "quota frame 1");
+  ASSERT_EQUALS_INT(other, fileIds[2], "quota frame 2");
+  ASSERT_EQUALS_INT(NO_PAGE, fileIds[3], "fourth frame never needed");
+  free(fileIds);
+  ASSERT_EQUALS_POOL("[1 0],[7 0],[6 0],[-1 0]", bm, "two most recent pages of the capped file");
+  CHECK(shutdownBufferPool(bm));
+
+  // the dirty page went to the second file only
+  CHECK(openPageFile("testbuffer2.bin", &fh));
+  CHECK(readBlock(1, &fh, ph));
+  ASSERT_EQUALS_STRING("Other-1", ph, "page written to its own file");
+  ASSERT_EQUALS_INT(2, fh.totalNumPages, "pins past the end don't grow the file");
+  CHECK(closePageFile(&fh));
+  checkDummyPages(bm, 10);
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  CHECK(destroyPageFile("testbuffer2.bin"));
+  CHECK(destroyPageFile("testbuffer3.bin"));
+  free(bm);
+  free(h);
+  free(ph);
+  TEST_DONE();
+}
+
+
+// page files grow by size changes, not by writing zeros page by page
+void testFileGrowth(void)
+{
+  int i;
+  FILE *file;
+  SM_FileHandle fh, other;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  testName = "Testing page file growth";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "new file has one page");
+  CHECK(setExtentPages(&fh, 16));
+  CHECK(ensureCapacity(1000, &fh));
+  ASSERT_EQUALS_INT(1000, fh.totalNumPages, "grown in one go");
+  ASSERT_EQUALS_INT(1008, fh.allocatedPages, "space reserved in whole extents");
+  CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(1001, fh.totalNumPages, "appended one page");
+  CHECK(readBlock(1000, &fh, ph));
+  for (i = 0; i < PAGE_SIZE && ph[i] == 0; i++)
+    ;
+  ASSERT_EQUALS_INT(PAGE_SIZE, i, "new pages read as zeros");
+  file = fopen("testbuffer.bin", "r");
+  fseek(file, 0, SEEK_END);
+  ASSERT_TRUE(ftell(file) == PAGE_FILE_HEADER_SIZE + 1001L * PAGE_SIZE, "file size matches the page count");
+  fclose(file);
+
+  // a handle that missed the growth never shrinks the file
+  CHECK(openPageFile("testbuffer.bin", &other));
+  CHECK(ensureCapacity(1010, &fh));
+  CHECK(ensureCapacity(1005, &other));
+  ASSERT_EQUALS_INT(1010, other.totalNumPages, "stale handle catches up");
+  CHECK(closePageFile(&other));
+
+  // writing past the end grows the file the same way
+  memset(ph, 'w', PAGE_SIZE);
+  CHECK(writeBlock(1030, &fh, ph));
+  ASSERT_EQUALS_INT(1031, fh.totalNumPages, "grown to the page written");
+  ASSERT_EQUALS_INT(1040, fh.allocatedPages, "space reserved in whole extents");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // checksummed files accept pages that were never written
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_PAGE_CHECKSUMS));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(0, &fh, ph));
+  CHECK(ensureCapacity(50, &fh));
+  CHECK(readBlock(49, &fh, ph));
+  sprintf(ph, "%s", "Written");
+  CHECK(writeBlock(49, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  CHECK(readBlock(49, &fh, ph));
+  ASSERT_EQUALS_STRING("Written", ph, "written page reads back");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(ph);
+  TEST_DONE();
+}
+
+
+// pages past the end of the file come up as zeros without I/O and reach the file when written back
+void testLazyZeroPages(void)
+{
+  int i;
+  SM_FileHandle fh;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing lazy zero pages past the end of file";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 3));
+  for (i = 0; i < PAGE_SIZE && h->data[i] == 0; i++)
+    ;
+  ASSERT_EQUALS_INT(PAGE_SIZE, i, "page past the end is zero filled");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "no read for a page past the end");
+
+  // appending: every page past the end, dirtied and written back once
+  for (i = 1; i < 10; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%d", "Page", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "appended pages are never read");
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(9, getNumWriteIO(bm), "one write per appended page");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(10, fh.totalNumPages, "file grew by the write-backs");
+  CHECK(closePageFile(&fh));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 9));
+  ASSERT_EQUALS_STRING("Page-9", h->data, "written page reads back");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+
+// page allocation through the free-space map kept in the page file
+void testFreeSpaceMap(void)
+{
+  int i, capacity;
+  PageNumber first, next;
+  struct stat st;
+  blkcnt_t used;
+  SM_FileHandle fh;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing the free-space map";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(RC_NO_FREE_SPACE_MAP, allocatePage(bm, 0, 1, &first), "file without a map");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_FREE_SPACE_MAP | SM_PAGE_CHECKSUMS));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  capacity = freeSpaceMapCapacity(&fh);
+  ASSERT_EQUALS_INT((PAGE_SIZE - PAGE_CHECKSUM_SIZE) * 8, capacity, "one bit per page");
+  ASSERT_EQUALS_INT(capacity + 1, freeSpaceMapPage(&fh, capacity + 5, &i), "second map page");
+  ASSERT_EQUALS_INT(3, i, "bit in the second map page");
+  CHECK(closePageFile(&fh));
+
+  // extents are contiguous and never include map pages
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  CHECK(allocatePage(bm, 0, 8, &first));
+  ASSERT_EQUALS_INT(1, first, "first extent after the map page");
+  CHECK(allocatePage(bm, 0, 4, &next));
+  ASSERT_EQUALS_INT(9, next, "next extent follows");
+  ASSERT_ERROR(allocatePage(bm, 0, capacity + 1, &next), "extent larger than a map page");
+  for (i = first; i < 13; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      memset(h->data, 'a' + i, PAGE_SIZE - PAGE_CHECKSUM_SIZE);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(forceFlushPool(bm));
+  stat("testbuffer.bin", &st);
+  used = st.st_blocks;
+
+  // freeing drops the frames, returns the disk space and lets the pages be handed out again
+  CHECK(pinPage(bm, h, 3));
+  ASSERT_EQUALS_INT(RC_BUFFER_IN_USE_BY_CLIENT, freePage(bm, 0, 1, 8), "pinned page can't be freed");
+  CHECK(unpinPage(bm, h));
+  CHECK(freePage(bm, 0, 1, 8));
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, freePage(bm, 0, 1, 1), "page freed twice");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, freePage(bm, 0, 0, 1), "map page can't be freed");
+  stat("testbuffer.bin", &st);
+  ASSERT_TRUE(st.st_blocks < used, "disk space given back");
+  CHECK(allocatePage(bm, 0, 2, &next));
+  ASSERT_EQUALS_INT(1, next, "freed pages reused first");
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_TRUE(h->data[0] == 0, "reused page reads as zeros");
+  CHECK(unpinPage(bm, h));
+  CHECK(allocatePage(bm, 0, 7, &next));
+  ASSERT_EQUALS_INT(13, next, "extent too large for the hole goes past it");
+  CHECK(pinPage(bm, h, 12));
+  ASSERT_TRUE(h->data[0] == 'a' + 12, "pages still allocated are untouched");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // the map is written back with the pool and read again by the next one
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  CHECK(allocatePage(bm, 0, 1, &next));
+  ASSERT_EQUALS_INT(3, next, "map survives the pool");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+
+// multi-page reads and writes, the scan cursor, the relative reads and read ahead in the pool
+void testVectoredIO(void)
+{
+  int i;
+  char expected[16];
+  SM_FileHandle fh;
+  SM_ScanCursor cursor;
+  SM_PageHandle pages[40], ph;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing vectored I/O and scans";
+
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_PAGE_CHECKSUMS));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 40; i++)
+    {
+      pages[i] = (SM_PageHandle) calloc(1, PAGE_SIZE);
+      sprintf(pages[i], "%s-%i", "Page", i);
+    }
+  CHECK(writeBlocks(0, 40, &fh, pages));
+  ASSERT_EQUALS_INT(40, fh.totalNumPages, "file grew to the pages written");
+  for (i = 0; i < 40; i++)
+    memset(pages[i], 0, PAGE_SIZE);
+  CHECK(readBlocks(10, 30, &fh, pages));
+  ASSERT_EQUALS_STRING("Page-10", pages[0], "first page of the range");
+  ASSERT_EQUALS_STRING("Page-39", pages[29], "last page of the range");
+  ASSERT_EQUALS_INT(39, getBlockPos(&fh), "last page read is the current one");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readBlocks(38, 3, &fh, pages), "range past the end");
+
+  // relative reads move the current page
+  CHECK(readFirstBlock(&fh, pages[0]));
+  CHECK(readNextBlock(&fh, pages[0]));
+  ASSERT_EQUALS_STRING("Page-1", pages[0], "next block");
+  CHECK(readCurrentBlock(&fh, pages[0]));
+  ASSERT_EQUALS_STRING("Page-1", pages[0], "current block");
+  CHECK(readPreviousBlock(&fh, pages[0]));
+  ASSERT_EQUALS_STRING("Page-0", pages[0], "previous block");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readPreviousBlock(&fh, pages[0]), "nothing before page 0");
+  CHECK(readLastBlock(&fh, pages[0]));
+  ASSERT_EQUALS_STRING("Page-39", pages[0], "last block");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, readNextBlock(&fh, pages[0]), "nothing after the last page");
+  sprintf(pages[0], "%s-%i", "Current", 39);
+  CHECK(writeCurrentBlock(&fh, pages[0]));
+  CHECK(readBlock(39, &fh, pages[1]));
+  ASSERT_EQUALS_STRING("Current-39", pages[1], "current block written");
+
+  // a scan crosses chunks and stops at the end of the file
+  CHECK(openScanCursor(&fh, 5, 100, 4, &cursor));
+  for (i = 5; scanNextBlock(&cursor, &ph) == RC_OK; i++)
+    {
+      sprintf(expected, "%s-%i", (i == 39) ? "Current" : "Page", i);
+      ASSERT_EQUALS_STRING(expected, ph, "page streamed by the scan");
+    }
+  ASSERT_EQUALS_INT(40, i, "scan ends with the file");
+  CHECK(closeScanCursor(&cursor));
+  CHECK(openScanCursor(&fh, 0, 10, 0, &cursor)); // closed before it is used up
+  CHECK(scanNextBlock(&cursor, &ph));
+  CHECK(closeScanCursor(&cursor));
+
+  // the handle holds the file open, reads and writes don't look the name up again
+  CHECK(rename("testbuffer.bin", "testbuffer_moved.bin") == 0 ? RC_OK : RC_ERROR);
+  CHECK(readBlock(3, &fh, pages[0]));
+  ASSERT_EQUALS_STRING("Page-3", pages[0], "read after the file was renamed");
+  CHECK(writeBlock(3, &fh, pages[0]));
+  CHECK(rename("testbuffer_moved.bin", "testbuffer.bin") == 0 ? RC_OK : RC_ERROR);
+  CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, readBlock(3, &fh, pages[0]), "closed handle");
+
+  // sequential misses are read ahead, a page written back meanwhile is read again
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 8));
+  sprintf(h->data, "%s-%i", "Changed", 8);
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page of the scan");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(pinPage(bm, h, 8));
+  ASSERT_EQUALS_STRING("Changed-8", h->data, "read-ahead copy dropped when the page was written back");
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "pages counted when used, page 8 twice");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  for (i = 0; i < 40; i++)
+    free(pages[i]);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+
+// callback of testAsyncPin: check the page and unpin it
+static int asyncPinsDone;
+static void asyncPinDone(BM_BufferPool *const bm, BM_PageHandle *const page, RC rc, void *ctx)
+{
+  char expected[16];
+  sprintf(expected, "%s-%i", "Page", *(int *) ctx);
+  ASSERT_EQUALS_INT(RC_OK, rc, "asynchronous pin succeeded");
+  ASSERT_EQUALS_INT(*(int *) ctx, page->pageNum, "pinned the page asked for");
+  ASSERT_EQUALS_STRING(expected, page->data, "page read by the I/O threads");
+  CHECK(unpinPage(bm, page));
+  asyncPinsDone++;
+}
+
+
+// pins that don't wait for the disk: hits at once, misses through the completion queue, one read per page
+void testAsyncPin(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle handles[40], *h = MAKE_PAGE_HANDLE();
+  int pageNums[40];
+  int i, rc, done, queued = 0;
+  uint64_t signalled;
+  testName = "Testing asynchronous pins";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 30);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 30, RS_LRU, NULL));
+
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+  rc = pinPageAsync(bm, &handles[0], 0, asyncPinDone, NULL);
+  ASSERT_EQUALS_INT(RC_OK, rc, "hit is pinned at once");
+  ASSERT_EQUALS_STRING("Page-0", handles[0].data, "hit");
+  CHECK(unpinPage(bm, &handles[0]));
+
+  // 20 different misses plus a second request for each of the first 10 pages, which shares the read
+  // still in flight or finds the page resident already
+  asyncPinsDone = 0;
+  for (i = 0; i < 30; i++)
+    {
+      pageNums[i] = 1 + i % 20;
+      rc = pinPageAsync(bm, &handles[i], pageNums[i], asyncPinDone, &pageNums[i]);
+      ASSERT_TRUE(rc == RC_PIN_PENDING || (i >= 20 && rc == RC_OK), "miss is queued");
+      if (rc == RC_OK)
+        {
+          CHECK(unpinPage(bm, &handles[i]));
+        }
+      else
+        queued++;
+    }
+  ASSERT_TRUE(queued >= 20, "every first request is queued");
+  rc = shutdownBufferPool(bm);
+  ASSERT_EQUALS_INT(RC_BUFFER_IN_USE_BY_CLIENT, rc, "pending pins keep the pool open");
+  while (getNumPendingPins(bm) > 0)
+    {
+      CHECK(pollPinCompletions(bm, 4, true, &done));
+      ASSERT_TRUE(done > 0 && done <= 4, "waits for completions, at most as many as asked for");
+    }
+  ASSERT_EQUALS_INT(queued, asyncPinsDone, "every callback ran");
+  ASSERT_EQUALS_INT(21, getNumReadIO(bm), "one read per page");
+  ASSERT_EQUALS_INT(queued - 20, getNumMergedPins(bm), "second requests in flight were merged");
+  CHECK(pollPinCompletions(bm, 0, false, &done));
+  ASSERT_EQUALS_INT(0, done, "no completions left");
+  ASSERT_TRUE(read(getPinCompletionFd(bm), &signalled, sizeof(signalled)) < 0, "completion descriptor drained");
+
+  // pages past the end of the file need no read
+  rc = pinPageAsync(bm, h, 100, asyncPinDone, NULL);
+  ASSERT_EQUALS_INT(RC_OK, rc, "new page pinned at once");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+
+// reader of testLatches: waits for the writer's latch, or upgrades its own shared latch
+static bool latchUpgrade;
+static void *latchWorker(void *arg)
+{
+  BM_BufferPool *bm = (BM_BufferPool *) arg;
+  BM_PageHandle h;
+  if (!latchUpgrade)
+    {
+      CHECK(pinPageLatched(bm, &h, 1, BM_LATCH_SHARED));
+      ASSERT_EQUALS_STRING("Written-1", h.data, "reader waited for the writer");
+      CHECK(unpinPageLatched(bm, &h, BM_LATCH_SHARED));
+      return NULL;
+    }
+  CHECK(pinPageLatched(bm, &h, 1, BM_LATCH_SHARED));
+  CHECK(upgradeLatch(bm, &h)); // waits for the main thread's shared latch
+  sprintf(h.data, "%s-%i", "Upgraded", 1);
+  CHECK(markDirty(bm, &h));
+  CHECK(unpinPageLatched(bm, &h, BM_LATCH_EXCLUSIVE));
+  return NULL;
+}
+
+
+// shared and exclusive latches on pinned pages
+void testLatches(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle a, b, c;
+  pthread_t worker;
+  int rc, *fixCounts;
+  testName = "Testing page latches";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 5);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  // readers share, a writer is turned away without being left pinned
+  CHECK(pinPageLatched(bm, &a, 1, BM_LATCH_SHARED));
+  CHECK(pinPageLatched(bm, &b, 1, BM_LATCH_SHARED));
+  rc = tryPinPageLatched(bm, &c, 1, BM_LATCH_EXCLUSIVE);
+  ASSERT_EQUALS_INT(RC_LATCH_BUSY, rc, "exclusive latch conflicts with readers");
+  fixCounts = getFixCounts(bm);
+  ASSERT_EQUALS_INT(2, fixCounts[0], "failed try leaves no pin behind");
+  free(fixCounts);
+  CHECK(unpinPageLatched(bm, &b, BM_LATCH_SHARED));
+  CHECK(upgradeLatch(bm, &a));
+  rc = tryPinPageLatched(bm, &c, 1, BM_LATCH_SHARED);
+  ASSERT_EQUALS_INT(RC_LATCH_BUSY, rc, "upgraded latch is exclusive");
+  CHECK(tryPinPageLatched(bm, &c, 2, BM_LATCH_EXCLUSIVE)); // other pages aren't affected
+  CHECK(unpinPageLatched(bm, &c, BM_LATCH_EXCLUSIVE));
+  CHECK(downgradeLatch(bm, &a));
+  CHECK(tryPinPageLatched(bm, &c, 1, BM_LATCH_SHARED));
+  CHECK(unpinPageLatched(bm, &c, BM_LATCH_SHARED));
+  rc = unpinPageLatched(bm, &a, BM_LATCH_EXCLUSIVE);
+  ASSERT_EQUALS_INT(RC_ERROR, rc, "latch not held in that mode");
+  CHECK(unpinPageLatched(bm, &a, BM_LATCH_SHARED));
+  ASSERT_EQUALS_INT(0, getNumLatchWaits(bm), "nothing waited so far");
+
+  // a reader waits for the writer and sees its change
+  latchUpgrade = false;
+  CHECK(pinPageLatched(bm, &a, 1, BM_LATCH_EXCLUSIVE));
+  pthread_create(&worker, NULL, latchWorker, bm);
+  usleep(20000);
+  sprintf(a.data, "%s-%i", "Written", 1);
+  CHECK(markDirty(bm, &a));
+  CHECK(unpinPageLatched(bm, &a, BM_LATCH_EXCLUSIVE));
+  pthread_join(worker, NULL);
+  ASSERT_EQUALS_INT(1, getNumLatchWaits(bm), "the reader waited");
+  ASSERT_TRUE(getLatchWaitMicros(bm) >= 10000, "for about as long as the writer held the latch");
+
+  // two upgraders would wait for each other: the second one is turned away
+  latchUpgrade = true;
+  CHECK(pinPageLatched(bm, &a, 1, BM_LATCH_SHARED));
+  pthread_create(&worker, NULL, latchWorker, bm);
+  usleep(20000);
+  rc = upgradeLatch(bm, &a);
+  ASSERT_EQUALS_INT(RC_LATCH_BUSY, rc, "second upgrade refused");
+  CHECK(unpinPageLatched(bm, &a, BM_LATCH_SHARED));
+  pthread_join(worker, NULL);
+  CHECK(pinPageLatched(bm, &a, 1, BM_LATCH_SHARED));
+  ASSERT_EQUALS_STRING("Upgraded-1", a.data, "first upgrade went through");
+  CHECK(unpinPageLatched(bm, &a, BM_LATCH_SHARED));
+  ASSERT_EQUALS_INT(2, getNumLatchWaits(bm), "the upgrade waited");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// reads of resident pages without pins, validated against the frame's version
+void testOptimisticReads(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_OptimisticRead r;
+  BM_PageHandle a;
+  char copy[PAGE_SIZE];
+  int rc, *fixCounts;
+  bool valid;
+  testName = "Testing optimistic reads";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  rc = lookupPageOptimistic(bm, 1, &r);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "page not resident yet");
+  CHECK(pinPage(bm, &a, 1));
+  CHECK(unpinPage(bm, &a));
+
+  // a read with nothing in between holds, and pins nothing
+  CHECK(lookupPageOptimistic(bm, 1, &r));
+  memcpy(copy, r.data, PAGE_SIZE);
+  valid = validateOptimisticRead(&r);
+  ASSERT_TRUE(valid, "read validated");
+  ASSERT_EQUALS_STRING("Page-1", copy, "copied the page");
+  fixCounts = getFixCounts(bm);
+  ASSERT_EQUALS_INT(0, fixCounts[0], "no pin taken");
+  free(fixCounts);
+
+  // a writer invalidates reads that overlap with it and holds off new ones
+  CHECK(beginOptimisticRead(&r));
+  CHECK(pinPageLatched(bm, &a, 1, BM_LATCH_EXCLUSIVE));
+  rc = beginOptimisticRead(&r);
+  ASSERT_EQUALS_INT(RC_LATCH_BUSY, rc, "writer holds the page");
+  sprintf(a.data, "%s-%i", "Changed", 1);
+  CHECK(markDirty(bm, &a));
+  CHECK(unpinPageLatched(bm, &a, BM_LATCH_EXCLUSIVE));
+  valid = validateOptimisticRead(&r);
+  ASSERT_TRUE(!valid, "overlapping read fails");
+  CHECK(beginOptimisticRead(&r));
+  memcpy(copy, r.data, PAGE_SIZE);
+  valid = validateOptimisticRead(&r);
+  ASSERT_TRUE(valid, "read after the writer holds");
+  ASSERT_EQUALS_STRING("Changed-1", copy, "sees the change");
+
+  // eviction invalidates the read, the frame holds another page then
+  CHECK(beginOptimisticRead(&r));
+  CHECK(pinPage(bm, &a, 2));
+  CHECK(unpinPage(bm, &a));
+  CHECK(pinPage(bm, &a, 3));
+  CHECK(unpinPage(bm, &a));
+  CHECK(pinPage(bm, &a, 4)); // replaces page 1
+  CHECK(unpinPage(bm, &a));
+  valid = validateOptimisticRead(&r);
+  ASSERT_TRUE(!valid, "read of an evicted page fails");
+  rc = beginOptimisticRead(&r);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "page is gone from its frame");
+  rc = lookupPageOptimistic(bm, 1, &r);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "and from the pool");
+
+  // frames dropped by a resize stay safe to check
+  CHECK(lookupPageOptimistic(bm, 4, &r));
+  CHECK(resizeBufferPool(bm, 1));
+  CHECK(pinPage(bm, &a, 5));
+  CHECK(unpinPage(bm, &a));
+  valid = validateOptimisticRead(&r);
+  ASSERT_TRUE(!valid, "read across a resize fails");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// wait up to a second for the evictor to free numFree frames
+static void waitForFreeFrames(BM_BufferPool *bm, int numFree)
+{
+  int i;
+  for (i = 0; i < 1000 && getNumFreeFrames(bm) < numFree; i++)
+    usleep(1000);
+}
+
+
+// free frames kept between watermarks by a background evictor
+void testBackgroundEvictor(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  int i, rc;
+  testName = "Testing the background evictor";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 12);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 6, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(6, getNumFreeFrames(bm), "all frames free at first");
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      if (i == 0)
+        CHECK(markDirty(bm, &h));
+      CHECK(unpinPage(bm, &h));
+    }
+  ASSERT_EQUALS_INT(0, getNumFreeFrames(bm), "pool full");
+  rc = setFreeFrameWatermarks(bm, 4, 2);
+  ASSERT_EQUALS_INT(RC_ERROR, rc, "high watermark below the low one");
+
+  // below the low watermark: the coldest pages go, the dirty one written back first
+  CHECK(setFreeFrameWatermarks(bm, 2, 3));
+  waitForFreeFrames(bm, 3);
+  ASSERT_EQUALS_INT(3, getNumFreeFrames(bm), "refilled up to the high watermark");
+  ASSERT_EQUALS_INT(3, getNumBackgroundEvictions(bm), "three pages evicted");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty page written back");
+  ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0],[3 0],[4 0],[5 0]", bm, "least recently used pages evicted");
+
+  // misses take free frames; once below the low watermark the evictor refills
+  CHECK(pinPage(bm, &h, 6));
+  CHECK(pinPage(bm, &h, 7));
+  waitForFreeFrames(bm, 3);
+  ASSERT_EQUALS_INT(3, getNumFreeFrames(bm), "refilled again");
+  ASSERT_EQUALS_INT(5, getNumBackgroundEvictions(bm), "two more evicted");
+  ASSERT_EQUALS_POOL("[6 1],[7 1],[-1 0],[-1 0],[-1 0],[5 0]", bm, "pinned pages stay");
+  CHECK(unpinPage(bm, &h));
+  h.pageNum = 6;
+  CHECK(unpinPage(bm, &h));
+
+  // with every frame pinned the evictor waits, misses evict inline as before
+  CHECK(setFreeFrameWatermarks(bm, 0, 0));
+  CHECK(setFreeFrameWatermarks(bm, 1, 1));
+  for (i = 0; i < 6; i++)
+    CHECK(pinPage(bm, &h, i));
+  ASSERT_EQUALS_INT(0, getNumFreeFrames(bm), "nothing left to evict");
+  for (i = 0; i < 6; i++)
+    {
+      h.pageNum = i;
+      CHECK(unpinPage(bm, &h));
+    }
+  CHECK(pinPage(bm, &h, 11));
+  CHECK(unpinPage(bm, &h));
+  waitForFreeFrames(bm, 1);
+  ASSERT_EQUALS_INT(1, getNumFreeFrames(bm), "refilled once pages were unpinned");
+
+  // shrinking scales the watermarks, 2 and 4 of 6 frames become 1 and 2 of 3: a high mark left at 4 would empty the pool
+  CHECK(setFreeFrameWatermarks(bm, 2, 4));
+  waitForFreeFrames(bm, 4);
+  CHECK(resizeBufferPool(bm, 3));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  waitForFreeFrames(bm, 2);
+  usleep(20000); // time for an evictor aiming past the pool to go on
+  rc = getNumFreeFrames(bm);
+  ASSERT_TRUE(rc <= 2, "shrunk pool keeps pages");
+  CHECK(resizeBufferPool(bm, 6));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// unpins page 0 of the pool after a while, for testPinWait
+static void *delayedUnpin(void *arg)
+{
+  BM_BufferPool *bm = (BM_BufferPool *) arg;
+  BM_PageHandle h;
+  usleep(20000);
+  h.pageNum = 0;
+  h.fileId = 0;
+  CHECK(unpinPage(bm, &h));
+  return NULL;
+}
+
+
+// misses wait for an unpin, for a while, when every frame is pinned
+void testPinWait(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle a, b, c;
+  pthread_t unpinner;
+  int rc;
+  testName = "Testing pins waiting for a free frame";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 5);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_FIFO, NULL));
+  CHECK(pinPage(bm, &a, 0));
+  CHECK(pinPage(bm, &b, 1));
+
+  CHECK(setPinWaitTimeout(bm, 0));
+  rc = pinPage(bm, &c, 2);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "fails at once without a timeout");
+  ASSERT_EQUALS_INT(0, getNumPinWaits(bm), "did not wait");
+  CHECK(pinPage(bm, &c, 1)); // hits need no frame
+  CHECK(unpinPage(bm, &c));
+
+  CHECK(setPinWaitTimeout(bm, 30));
+  rc = pinPage(bm, &c, 2);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "gives up after the timeout");
+  ASSERT_EQUALS_INT(1, getNumPinWaits(bm), "waited once");
+  ASSERT_TRUE(getPinWaitMicros(bm) >= 25000, "for about the timeout");
+  ASSERT_EQUALS_INT(2, getNumPinTimeouts(bm), "both pins timed out");
+
+  // an unpin from another thread lets the waiting pin through
+  CHECK(setPinWaitTimeout(bm, 5000));
+  pthread_create(&unpinner, NULL, delayedUnpin, bm);
+  CHECK(pinPage(bm, &c, 2));
+  pthread_join(unpinner, NULL);
+  ASSERT_EQUALS_INT(2, getNumPinWaits(bm), "waited again");
+  ASSERT_EQUALS_INT(2, getNumPinTimeouts(bm), "without timing out");
+  ASSERT_EQUALS_POOL("[2 1],[1 1]", bm, "page 2 took the unpinned frame");
+
+  CHECK(unpinPage(bm, &b));
+  CHECK(unpinPage(bm, &c));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// lookups find pages in every frame, the last ones past a multiple of the vector width included
+void testFrameLookup(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  PageNumber *contents;
+  int i, other, reads, *fileIds;
+  char expected[32];
+  testName = "Testing frame lookups";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 40);
+  CHECK(createPageFile("testbuffer2.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 43, RS_FIFO, NULL));
+  CHECK(registerPageFile(bm, "testbuffer2.bin", &other));
+  for (i = 0; i < 3; i++) // page numbers the first file has too
+    {
+      CHECK(pinFilePage(bm, &h, other, i));
+      sprintf(h.data, "%s-%i", "Other", i);
+      CHECK(markDirty(bm, &h));
+      CHECK(unpinPage(bm, &h));
+    }
+  for (i = 0; i < 40; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  reads = getNumReadIO(bm);
+
+  for (i = 39; i >= 0; i--)
+    {
+      CHECK(pinPage(bm, &h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h.data, "page of the pool's file");
+      CHECK(unpinPage(bm, &h));
+    }
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinFilePage(bm, &h, other, i));
+      sprintf(expected, "%s-%i", "Other", i);
+      ASSERT_EQUALS_STRING(expected, h.data, "page of the other file");
+      CHECK(unpinPage(bm, &h));
+    }
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "all hits");
+  contents = getFrameContents(bm);
+  fileIds = getFrameFileIds(bm);
+  ASSERT_EQUALS_INT(39, contents[42], "last frame");
+  ASSERT_EQUALS_INT(0, fileIds[42], "of the pool's file");
+  ASSERT_EQUALS_INT(2, contents[2], "third frame");
+  ASSERT_EQUALS_INT(other, fileIds[2], "of the other file");
+  free(contents);
+  free(fileIds);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  CHECK(destroyPageFile("testbuffer2.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// most recently used policy for testCustomPolicy: replaces the unpinned page used last
+typedef struct MruState
+{
+  long clock;
+  long lastUse[8];
+  int pins[8];
+  int evictions;
+  int unpins;
+  int moves;
+} MruState;
+
+static void mruUse(BM_BufferPool *const bm, void *data, const int frame)
+{
+  MruState *st = (MruState *) data;
+  st->lastUse[frame] = ++st->clock;
+  st->pins[frame] += 1;
+}
+
+static void mruUnpin(BM_BufferPool *const bm, void *data, const int frame)
+{
+  MruState *st = (MruState *) data;
+  st->pins[frame] = 0;
+  st->unpins += 1;
+}
+
+static int mruVictim(BM_BufferPool *const bm, void *data)
+{
+  MruState *st = (MruState *) data;
+  int i, victim = -1;
+  for (i = 0; i < bm->numPages; i++)
+    if (st->pins[i] == 0 && (victim < 0 || st->lastUse[i] > st->lastUse[victim]))
+      victim = i;
+  return victim;
+}
+
+static void mruEvict(BM_BufferPool *const bm, void *data, const int frame)
+{
+  ((MruState *) data)->evictions += 1;
+}
+
+static void mruMove(BM_BufferPool *const bm, void *data, const int from, const int to)
+{
+  MruState *st = (MruState *) data;
+  long lastUse = st->lastUse[to];
+  int pins = st->pins[to];
+  st->lastUse[to] = st->lastUse[from];
+  st->pins[to] = st->pins[from];
+  st->lastUse[from] = lastUse;
+  st->pins[from] = pins;
+  st->moves += 1;
+}
+
+
+// a replacement policy passed in through stratData, and switched at run time
+void testCustomPolicy(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  MruState st;
+  BM_ReplacementPolicy mru = { mruUse, mruUse, mruUnpin, mruVictim, mruEvict, mruMove, &st };
+  BM_ReplacementPolicy broken = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+  PageNumber *contents, first;
+  int i, rc;
+  testName = "Testing a custom replacement policy";
+
+  memset(&st, 0, sizeof(st));
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, &mru));
+  for (i = 0; i < 3; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  CHECK(pinPage(bm, &h, 0)); // page 0 is used last now
+  CHECK(unpinPage(bm, &h));
+  CHECK(pinPage(bm, &h, 3));
+  ASSERT_EQUALS_POOL("[3 1],[1 0],[2 0]", bm, "most recently used page replaced");
+  CHECK(pinPage(bm, &h, 4)); // page 3 is pinned, page 2 was used after page 1
+  ASSERT_EQUALS_POOL("[3 1],[1 0],[4 1]", bm, "pinned page kept");
+  ASSERT_EQUALS_INT(2, st.evictions, "policy saw both evictions");
+  ASSERT_EQUALS_INT(4, st.unpins, "and the unpins");
+  CHECK(unpinPage(bm, &h));
+  h.pageNum = 3;
+  CHECK(unpinPage(bm, &h));
+
+  // a shrink moves pages 1 and 4 to frames 0 and 1, and the policy's state with them
+  CHECK(pinPage(bm, &h, 4));
+  CHECK(pinPage(bm, &h, 1)); // used last
+  CHECK(resizeBufferPool(bm, 2)); // page 3 is the only unpinned one
+  ASSERT_EQUALS_POOL("[1 1],[4 1]", bm, "pinned pages moved to the front");
+  ASSERT_EQUALS_INT(3, st.evictions, "policy saw the eviction");
+  ASSERT_EQUALS_INT(2, st.moves, "and both moves");
+  CHECK(unpinPage(bm, &h));
+  h.pageNum = 4;
+  CHECK(unpinPage(bm, &h));
+  CHECK(pinPage(bm, &h, 5));
+  ASSERT_EQUALS_POOL("[5 1],[4 0]", bm, "most recently used page replaced in its new frame");
+  CHECK(unpinPage(bm, &h));
+
+  // back to the built-in FIFO
+  rc = setReplacementPolicy(bm, &broken);
+  ASSERT_EQUALS_INT(RC_ERROR, rc, "a policy must choose victims");
+  CHECK(setReplacementPolicy(bm, NULL));
+  CHECK(pinPage(bm, &h, 6));
+  CHECK(unpinPage(bm, &h));
+  contents = getFrameContents(bm);
+  ASSERT_TRUE(contents[0] == 6 || contents[1] == 6, "page 6 replaced one of the pages");
+  free(contents);
+  ASSERT_EQUALS_INT(4, st.evictions, "custom policy no longer called");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  // freed pages leave their frames through the policy too
+  memset(&st, 0, sizeof(st));
+  CHECK(createPageFileWithOptions("testbuffer.bin", PAGE_SIZE, SM_FREE_SPACE_MAP));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, &mru));
+  CHECK(allocatePage(bm, 0, 2, &first));
+  for (i = first; i < first + 2; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  CHECK(freePage(bm, 0, first, 2));
+  ASSERT_EQUALS_INT(2, st.evictions, "policy saw the freed pages go");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+void testCleanFirst(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  PageNumber *contents;
+  int i, writes, window;
+  testName = "Testing clean-first eviction";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  CHECK(pinPage(bm, &h, 0)); // the coldest page, and dirty
+  CHECK(markDirty(bm, &h));
+  CHECK(unpinPage(bm, &h));
+  for (i = 1; i < 4; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  writes = getNumWriteIO(bm);
+
+  CHECK(setCleanFirstWindow(bm, 50, false)); // the two coldest frames
+  for (i = 4; i < 6; i++)
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+  contents = getFrameContents(bm);
+  ASSERT_EQUALS_INT(0, contents[0], "dirty page stays");
+  ASSERT_EQUALS_INT(4, contents[1], "in place of the next coldest");
+  ASSERT_EQUALS_INT(5, contents[2], "still in the window");
+  free(contents);
+  ASSERT_EQUALS_INT(writes, getNumWriteIO(bm), "no write-back");
+  ASSERT_EQUALS_INT(2, getNumCleanFirstEvictions(bm), "clean pages evicted instead");
+
+  CHECK(setCleanFirstWindow(bm, 25, false)); // page 3 is second coldest, outside the window
+  CHECK(pinPage(bm, &h, 6));
+  CHECK(unpinPage(bm, &h));
+  contents = getFrameContents(bm);
+  ASSERT_EQUALS_INT(6, contents[0], "dirty page evicted");
+  ASSERT_EQUALS_INT(3, contents[3], "clean page outside the window stays");
+  free(contents);
+  ASSERT_EQUALS_INT(writes + 1, getNumWriteIO(bm), "written back");
+
+  CHECK(setCleanFirstWindow(bm, 80, true));
+  window = getCleanFirstWindow(bm); // measured reads and writes of the page cache, either may be dearer
+  ASSERT_TRUE(window >= 0 && window <= 80, "adaptive window within the maximum");
+  ASSERT_TRUE(setCleanFirstWindow(bm, 101, false) != RC_OK, "window over 100%");
+  CHECK(setCleanFirstWindow(bm, 0, false));
+  ASSERT_EQUALS_INT(0, getCleanFirstWindow(bm), "off");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+static bool isResident(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+  PageNumber *contents = getFrameContents(bm);
+  bool found = false;
+  int i;
+  for (i = 0; i < bm->numPages; i++)
+    found = found || contents[i] == pageNum;
+  free(contents);
+  return found;
+}
+
+
+static void pinAndUnpin(BM_BufferPool *const bm, const PageNumber pageNum, const BM_PinHint hint)
+{
+  BM_PageHandle h;
+  CHECK(pinPageWithHint(bm, &h, pageNum, hint));
+  CHECK(unpinPage(bm, &h));
+}
+
+
+void testPinHints(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU };
+  int s, i, writes;
+  bool resident;
+  testName = "Testing pin hints and sticky pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 30);
+  for (s = 0; s < 4; s++) // a burst of cold pages leaves the sticky page alone, whatever the strategy
+    {
+      CHECK(initBufferPool(bm, "testbuffer.bin", 4, strategies[s], NULL));
+      ASSERT_EQUALS_INT(RC_STICKY_LIMIT, setPageSticky(bm, 0, 0, true), "no sticky pages in 10% of 4 frames");
+      CHECK(setStickyLimit(bm, 25));
+      CHECK(setPageSticky(bm, 0, 0, true));
+      ASSERT_EQUALS_INT(RC_STICKY_LIMIT, setPageSticky(bm, 0, 1, true), "one sticky page in 25% of 4 frames");
+      pinAndUnpin(bm, 0, BM_HINT_NORMAL);
+      for (i = 10; i < 30; i++)
+        pinAndUnpin(bm, i, BM_HINT_NORMAL);
+      resident = isResident(bm, 0);
+      ASSERT_TRUE(resident, "sticky page kept");
+      CHECK(setPageSticky(bm, 0, 0, false));
+      ASSERT_EQUALS_INT(0, getNumStickyPages(bm), "sticky set empty");
+      for (i = 10; i < 30; i++)
+        pinAndUnpin(bm, i, BM_HINT_NORMAL);
+      resident = isResident(bm, 0);
+      ASSERT_TRUE(!resident, "replaced once no longer sticky");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  for (i = 0; i < 4; i++)
+    pinAndUnpin(bm, i, (i == 3) ? BM_HINT_EVICT_SOON : BM_HINT_NORMAL);
+  pinAndUnpin(bm, 4, BM_HINT_NORMAL);
+  resident = isResident(bm, 3);
+  ASSERT_TRUE(!resident, "evict-soon page replaced first");
+  resident = isResident(bm, 0);
+  ASSERT_TRUE(resident, "instead of the least recently used one");
+
+  writes = getNumWriteIO(bm);
+  CHECK(pinPageWithHint(bm, &h, 5, BM_HINT_WILL_NOT_NEED));
+  CHECK(markDirty(bm, &h));
+  CHECK(unpinPage(bm, &h));
+  resident = isResident(bm, 5);
+  ASSERT_TRUE(!resident, "will-not-need page dropped at unpin");
+  ASSERT_EQUALS_INT(writes + 1, getNumWriteIO(bm), "and written back");
+  ASSERT_EQUALS_INT(1, getNumFreeFrames(bm), "its frame is free");
+
+  pinAndUnpin(bm, 6, BM_HINT_KEEP_HOT); // into the frame page 5 left
+  pinAndUnpin(bm, 1, BM_HINT_NORMAL); // which makes page 6 the least recently used
+  pinAndUnpin(bm, 2, BM_HINT_NORMAL);
+  pinAndUnpin(bm, 4, BM_HINT_NORMAL);
+  pinAndUnpin(bm, 7, BM_HINT_NORMAL);
+  resident = isResident(bm, 6);
+  ASSERT_TRUE(resident, "keep-hot page passed over");
+  pinAndUnpin(bm, 8, BM_HINT_NORMAL);
+  pinAndUnpin(bm, 9, BM_HINT_NORMAL);
+  pinAndUnpin(bm, 10, BM_HINT_NORMAL);
+  resident = isResident(bm, 6);
+  ASSERT_TRUE(!resident, "but only once");
+  ASSERT_TRUE(pinPageWithHint(bm, &h, 1, (BM_PinHint) 7) != RC_OK, "unknown hint");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+static void pinForTenant(BM_BufferPool *const bm, const int tenantId, const PageNumber pageNum)
+{
+  BM_PageHandle h;
+  CHECK(pinPageForTenant(bm, &h, tenantId, 0, pageNum, BM_HINT_NORMAL));
+  CHECK(unpinPage(bm, &h));
+}
+
+
+void testTenants(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  int i, frames, hits, misses;
+  testName = "Testing tenant quotas";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 60);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+  CHECK(setTenantQuota(bm, 1, 4, 0)); // keeps four frames
+  CHECK(setTenantQuota(bm, 2, 0, 2)); // scans through two
+  ASSERT_TRUE(setTenantQuota(bm, 3, 5, 0) != RC_OK, "minimums over the pool size");
+  ASSERT_TRUE(setTenantQuota(bm, 3, 2, 1) != RC_OK, "minimum over maximum");
+  ASSERT_TRUE(setTenantQuota(bm, MAX_TENANTS, 0, 0) != RC_OK, "no such tenant");
+  ASSERT_TRUE(pinPageForTenant(bm, &h, -1, 0, 0, BM_HINT_NORMAL) != RC_OK, "pin for no such tenant");
+
+  for (i = 0; i < 4; i++)
+    pinForTenant(bm, 1, i);
+  for (i = 10; i < 30; i++)
+    pinForTenant(bm, 2, i);
+  CHECK(getTenantStats(bm, 2, &frames, &hits, &misses));
+  ASSERT_EQUALS_INT(2, frames, "scan kept to its maximum");
+  ASSERT_EQUALS_INT(20, misses, "scan misses");
+  for (i = 40; i < 60; i++) // untagged pins, the oldest pages are tenant 1's
+    {
+      CHECK(pinPage(bm, &h, i));
+      CHECK(unpinPage(bm, &h));
+    }
+
+  for (i = 0; i < 4; i++)
+    pinForTenant(bm, 1, i);
+  CHECK(getTenantStats(bm, 1, &frames, &hits, &misses));
+  ASSERT_EQUALS_INT(4, frames, "minimum kept");
+  ASSERT_EQUALS_INT(4, hits, "its pages survived both bursts");
+  ASSERT_EQUALS_INT(4, misses, "first reads only");
+  CHECK(getTenantStats(bm, BM_DEFAULT_TENANT, &frames, &hits, &misses));
+  ASSERT_EQUALS_INT(20, misses, "untagged pins counted for the default tenant");
+  ASSERT_EQUALS_INT(4, frames, "every frame tenant 1 does not keep");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// Writes past maxBytes into any file fail with EFBIG from here on, until unlimitFileSize; the signal is ignored
+static struct rlimit savedFileLimit;
+
+static void limitFileSize(const off_t maxBytes)
+{
+  struct rlimit limit;
+  getrlimit(RLIMIT_FSIZE, &savedFileLimit);
+  limit = savedFileLimit;
+  limit.rlim_cur = maxBytes;
+  signal(SIGXFSZ, SIG_IGN);
+  setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+
+static void unlimitFileSize(void)
+{
+  setrlimit(RLIMIT_FSIZE, &savedFileLimit);
+  signal(SIGXFSZ, SIG_DFL);
+}
+
+
+// A dirty page whose write-back fails keeps its frame, so the change is written once the file takes writes again
+void testFailedWriteBack(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  PageNumber far = 20000; // 80 MB into the file, past the limit below
+  RC pinRC, resizeRC;
+  bool resident;
+  testName = "Testing failed write-backs";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 4);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU, NULL));
+  CHECK(pinPage(bm, &h, far));
+  sprintf(h.data, "%s-%i", "Page", far);
+  CHECK(markDirty(bm, &h));
+  CHECK(unpinPage(bm, &h));
+  CHECK(pinPage(bm, &h, 0));
+  CHECK(unpinPage(bm, &h));
+
+  limitFileSize(64 * 1024 * 1024);
+  resizeRC = resizeBufferPool(bm, 1); // the dirty page is the coldest
+  pinRC = pinPage(bm, &h, 1); // and the victim of this miss
+  unlimitFileSize();
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, resizeRC, "shrinking fails when the page can't be written");
+  ASSERT_EQUALS_INT(2, bm->numPages, "pool keeps its size");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, pinRC, "the miss fails too");
+  resident = isResident(bm, far);
+  ASSERT_TRUE(resident, "dirty page kept its frame");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "nothing written");
+
+  CHECK(pinPage(bm, &h, 1));
+  CHECK(unpinPage(bm, &h));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "written back once the file takes writes");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LRU, NULL));
+  CHECK(pinPage(bm, &h, far));
+  ASSERT_EQUALS_STRING("Page-20000", h.data, "change survived the failed writes");
+  CHECK(unpinPage(bm, &h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// Records a failed flush held are gone, so the log refuses to go on past them
+void testFailedLogWrite(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  WAL_Log *log;
+  LSN first, lost, commit, update;
+  RC flushRC, commitRC, retryRC, appendRC, writeRC;
+  testName = "Testing failed log writes";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  unlink("testbuffer.log");
+  CHECK(openLog("testbuffer.log", &log));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 1, RS_FIFO, NULL));
+  CHECK(attachLog(bm, log));
+  CHECK(appendLogRecord(log, WAL_PAGE_UPDATE, 5, 0, 4, "abcd", &first));
+  CHECK(flushLog(log, first));
+  CHECK(pinPage(bm, &h, 0));
+  CHECK(logPageUpdate(bm, &h, 0, 4, &update)); // lands in the records the failed flush takes
+  CHECK(unpinPage(bm, &h));
+  CHECK(appendLogRecord(log, WAL_PAGE_UPDATE, 6, 0, 4, "efgh", &lost));
+
+  fflush(stdout); // nothing may be printed until the limit is lifted, stdout can be a file past it
+  limitFileSize(first);
+  flushRC = flushLog(log, lost);
+  unlimitFileSize();
+  commitRC = commitLog(log, &commit);
+  retryRC = flushLog(log, lost);
+  appendRC = appendLogRecord(log, WAL_PAGE_UPDATE, 7, 0, 4, "ijkl", &commit);
+  writeRC = forceFlushPool(bm);
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, flushRC, "flush past the file size limit");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, commitRC, "no commit after it");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, retryRC, "a retry would leave a hole");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, appendRC, "nor appends");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, writeRC, "page logged in the lost records not written");
+  CHECK(flushLog(log, first)); // durable before the failure
+  ASSERT_TRUE(getNumWriteIO(bm) == 0, "page file untouched");
+
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_ERROR(closeLog(log), "closing reports the lost records");
+  CHECK(openLog("testbuffer.log", &log));
+  ASSERT_TRUE(getLogEnd(log) == first, "log ends at the last durable record");
+  CHECK(closeLog(log));
+  unlink("testbuffer.log");
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+
+// Every strategy passes over a pinned frame: its buffer is the client's until the unpin
+void testPinnedPageNotReplaced(void)
+{
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h0, h;
+  int s, i, rc;
+  bool resident;
+  testName = "Testing that pinned pages are not replaced";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  for (s = 0; s < 4; s++)
+    {
+      CHECK(initBufferPool(bm, "testbuffer.bin", 3, strategies[s], NULL));
+      CHECK(pinPage(bm, &h0, 0));
+      for (i = 1; i < 20; i++) // page 0 comes round as the victim of every strategy's first pass
+        {
+          CHECK(pinPage(bm, &h, i));
+          CHECK(unpinPage(bm, &h));
+        }
+      ASSERT_EQUALS_STRING("Page-0", h0.data, "pinned page's data untouched");
+      resident = isResident(bm, 0);
+      ASSERT_TRUE(resident, "pinned page still cached");
+      CHECK(unpinPage(bm, &h0));
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  // LFU: the only unpinned frame is the one after the hand, and used more than once
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+  CHECK(pinPage(bm, &h, 0));
+  CHECK(unpinPage(bm, &h));
+  CHECK(pinPage(bm, &h0, 1));
+  CHECK(pinPage(bm, &h, 2));
+  CHECK(pinPage(bm, &h, 0));
+  CHECK(unpinPage(bm, &h));
+  CHECK(pinPage(bm, &h, 3));
+  ASSERT_EQUALS_POOL("[3 1],[1 1],[2 1]", bm, "page 0 replaced despite its count");
+  rc = pinPage(bm, &h, 4);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no victim while every frame is pinned");
+  CHECK(unpinPage(bm, &h0));
+  h.pageNum = 2;
+  CHECK(unpinPage(bm, &h));
+  h.pageNum = 3;
+  CHECK(unpinPage(bm, &h));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "wal_mgr.h"
+#include "storage_mgr.h"
+
+/*
+ * The log is a plain sequence of records, each a header followed by its payload.
+ * A record's LSN is the log offset just past its end, so a record is durable once
+ * flushedLSN has reached its LSN. Commits are grouped: the first committer to find
+ * no flush in progress writes and syncs everything appended so far, the others
+ * wait for it and usually find their record durable when it is done.
+ *
+ * A failed write or sync fails the log for good. The records it held were taken out of
+ * the buffer and may or may not have reached the disk, and a later flush could not fill
+ * the gap, so appends, flushes past flushedLSN and commits return RC_WRITE_FAILED from
+ * then on; flushedLSN stays where it was, so pages logged after it are never written.
+ */
+#define WAL_RECORD_MAGIC 0x4C415752  // "RWAL"
+#define WAL_INITIAL_BUFFER 65536
+
+typedef struct WAL_RecordHeader {
+	unsigned int magic;
+	int type;
+	int size;  // header and payload
+	int pageNum;
+	int offset;  // position of the after-image inside the page
+	int length;
+	LSN lsn;
+} WAL_RecordHeader;
+
+
+// Read the record starting at offset, false at the end of the log or at a torn record
+static bool readRecordAt (int fd, LSN offset, WAL_RecordHeader *header, char **payload)
+{
+	if (pread(fd, header, sizeof(WAL_RecordHeader), offset) != sizeof(WAL_RecordHeader))
+		return false;
+	if (header->magic != WAL_RECORD_MAGIC || header->length < 0
+			|| header->size != (int) sizeof(WAL_RecordHeader) + header->length
+			|| header->lsn != offset + header->size)
+		return false;
+
+	*payload = (char *) malloc(header->length > 0 ? header->length : 1);
+	if (pread(fd, *payload, header->length, offset + sizeof(WAL_RecordHeader)) != header->length)
+	{
+		free(*payload);
+		return false;
+	}
+	return true;
+}
+
+
+extern RC openLog (char *fileName, WAL_Log **log)
+{
+	WAL_RecordHeader header;
+	char *payload;
+	LSN end = 0;
+	WAL_Log *l;
+	int fd = open(fileName, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return RC_FILE_NOT_FOUND;
+
+	// Find the end of the last complete record and cut off a torn tail
+	while (readRecordAt(fd, end, &header, &payload))
+	{
+		end = header.lsn;
+		free(payload);
+	}
+	if (ftruncate(fd, end) != 0)
+	{
+		close(fd);
+		return RC_WRITE_FAILED;
+	}
+
+	l = (WAL_Log *) calloc(1, sizeof(WAL_Log));
+	l->fileName = fileName;
+	l->fd = fd;
+	pthread_mutex_init(&l->lock, NULL);
+	pthread_cond_init(&l->flushed, NULL);
+	l->bufSize = WAL_INITIAL_BUFFER;
+	l->buffer = (char *) malloc(l->bufSize);
+	l->flushBufSize = WAL_INITIAL_BUFFER;
+	l->flushBuf = (char *) malloc(l->flushBufSize);
+	l->bufStartLSN = end;
+	l->nextLSN = end;
+	l->flushedLSN = end;
+	*log = l;
+	return RC_OK;
+}
+
+
+extern RC closeLog (WAL_Log *log)
+{
+	RC rc = flushLog(log, log->nextLSN);
+	close(log->fd);
+	pthread_mutex_destroy(&log->lock);
+	pthread_cond_destroy(&log->flushed);
+	free(log->buffer);
+	free(log->flushBuf);
+	free(log);
+	return rc;
+}
+
+
+extern void setGroupCommitDelay (WAL_Log *log, int micros)
+{
+	log->groupCommitDelay = micros;
+}
+
+
+extern RC appendLogRecord (WAL_Log *log, WAL_RecordType type, int pageNum, int offset, int length, const char *data, LSN *lsn)
+{
+	WAL_RecordHeader header;
+	size_t size = sizeof(WAL_RecordHeader) + length;
+
+	header.magic = WAL_RECORD_MAGIC;
+	header.type = type;
+	header.size = size;
+	header.pageNum = pageNum;
+	header.offset = offset;
+	header.length = length;
+
+	pthread_mutex_lock(&log->lock);
+	if (log->failed)
+	{
+		pthread_mutex_unlock(&log->lock);
+		return RC_WRITE_FAILED;
+	}
+	if (log->bufUsed + size > log->bufSize)
+	{
+		while (log->bufUsed + size > log->bufSize)
+			log->bufSize *= 2;
+		log->buffer = (char *) realloc(log->buffer, log->bufSize);
+	}
+	header.lsn = log->nextLSN + size;
+	memcpy(log->buffer + log->bufUsed, &header, sizeof(header));
+	if (length > 0)
+		memcpy(log->buffer + log->bufUsed + sizeof(header), data, length);
+	log->bufUsed += size;
+	log->nextLSN = header.lsn;
+	*lsn = header.lsn;
+	pthread_mutex_unlock(&log->lock);
+	return RC_OK;
+}
+
+
+// Make every record up to lsn durable, joining a flush already in progress when there is one
+extern RC flushLog (WAL_Log *log, LSN lsn)
+{
+	RC rc = RC_OK;
+	pthread_mutex_lock(&log->lock);
+	if (lsn > log->nextLSN)
+		lsn = log->nextLSN;
+	while (log->flushedLSN < lsn)
+	{
+		if (log->failed)
+		{
+			rc = RC_WRITE_FAILED;
+			break;
+		}
+		if (log->flushing)  // somebody is syncing already, its flush may cover lsn
+		{
+			pthread_cond_wait(&log->flushed, &log->lock);
+			continue;
+		}
+
+		log->flushing = true;
+		if (log->groupCommitDelay > 0)  // give other committers a chance to join this flush
+		{
+			pthread_mutex_unlock(&log->lock);
+			usleep(log->groupCommitDelay);
+			pthread_mutex_lock(&log->lock);
+		}
+
+		// Take everything appended so far, appenders continue in the other buffer
+		char *pending = log->buffer;
+		size_t pendingSize = log->bufSize;
+		size_t count = log->bufUsed;
+		LSN start = log->bufStartLSN;
+		LSN end = log->nextLSN;
+		log->buffer = log->flushBuf;
+		log->bufSize = log->flushBufSize;
+		log->flushBuf = pending;
+		log->flushBufSize = pendingSize;
+		log->bufUsed = 0;
+		log->bufStartLSN = end;
+		pthread_mutex_unlock(&log->lock);
+
+		bool written = pwrite(log->fd, pending, count, start) == (ssize_t) count && fdatasync(log->fd) == 0;
+
+		pthread_mutex_lock(&log->lock);
+		log->flushing = false;
+		if (written)
+		{
+			log->flushedLSN = end;
+			log->numFlushes += 1;
+		}
+		else
+			log->failed = true;
+		pthread_cond_broadcast(&log->flushed);  // waiters find the log failed on their next check
+	}
+	pthread_mutex_unlock(&log->lock);
+	return rc;
+}
+
+
+extern RC commitLog (WAL_Log *log, LSN *lsn)
+{
+	RC rc = appendLogRecord(log, WAL_COMMIT, -1, 0, 0, NULL, lsn);
+	if (rc != RC_OK)
+		return rc;
+	pthread_mutex_lock(&log->lock);
+	log->numCommits += 1;
+	pthread_mutex_unlock(&log->lock);
+	return flushLog(log, *lsn);
+}
+
+
+// LSN the next record will end after, everything logged so far is below it
+extern LSN getLogEnd (WAL_Log *log)
+{
+	LSN end;
+	pthread_mutex_lock(&log->lock);
+	end = log->nextLSN;
+	pthread_mutex_unlock(&log->lock);
+	return end;
+}
+
+
+// Where redo has to start: the redo LSN of the last completed checkpoint, or the start of the log
+extern RC findCheckpointRedoLSN (char *logFileName, LSN *redoLSN)
+{
+	WAL_RecordHeader header;
+	char *payload;
+	LSN offset = 0;
+	int fd = open(logFileName, O_RDONLY);
+	if (fd < 0)
+		return RC_FILE_NOT_FOUND;
+
+	*redoLSN = NO_LSN;
+	while (readRecordAt(fd, offset, &header, &payload))
+	{
+		if (header.type == WAL_CHECKPOINT_END && header.length == sizeof(LSN))
+			memcpy(redoLSN, payload, sizeof(LSN));
+		offset = header.lsn;
+		free(payload);
+	}
+	close(fd);
+	return RC_OK;
+}
+
+
+// Redo the page updates logged after fromLSN against the page file
+extern RC replayLog (char *logFileName, char *pageFileName, LSN fromLSN, int *numApplied)
+{
+	WAL_RecordHeader header;
+	SM_FileHandle fh;
+	SM_PageHandle ph;
+	char *payload;
+	LSN offset = fromLSN;
+	int fd = open(logFileName, O_RDONLY);
+	if (fd < 0)
+		return RC_FILE_NOT_FOUND;
+	if (openPageFile(pageFileName, &fh) != RC_OK)
+	{
+		close(fd);
+		return RC_FILE_NOT_FOUND;
+	}
+
+	*numApplied = 0;
+	ph = (SM_PageHandle) malloc(fh.pageSize);
+	while (readRecordAt(fd, offset, &header, &payload))
+	{
+		offset = header.lsn;
+		if (header.type == WAL_PAGE_UPDATE && header.offset >= 0 && header.offset + header.length <= fh.pageSize)
+		{
+			// After-images are applied in log order, so replaying a record twice is harmless
+			if (header.pageNum >= fh.totalNumPages)
+				ensureCapacity(header.pageNum + 1, &fh);
+			readBlock(header.pageNum, &fh, ph);
+			memcpy(ph + header.offset, payload, header.length);
+			writeBlock(header.pageNum, &fh, ph);
+			*numApplied += 1;
+		}
+		free(payload);
+	}
+	free(ph);
+	closePageFile(&fh);
+	close(fd);
+	return RC_OK;
+}
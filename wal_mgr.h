@@ -0,0 +1,74 @@
+#ifndef WAL_MGR_H
+#define WAL_MGR_H
+
+#include <pthread.h>
+#include "dberror.h"
+#include "dt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************
+ *                    handle data structures                *
+ ************************************************************/
+// Log sequence number: offset just past the end of a record in the log file
+typedef long long LSN;
+#define NO_LSN 0
+
+typedef enum WAL_RecordType {
+	WAL_PAGE_UPDATE = 1,  // after-image of a byte range of a page
+	WAL_COMMIT = 2,
+	WAL_CHECKPOINT_BEGIN = 3,  // dirty page table: (page, recLSN) pairs
+	WAL_CHECKPOINT_END = 4  // redo LSN of the checkpoint
+} WAL_RecordType;
+
+typedef struct WAL_Log {
+	char *fileName;
+	int fd;
+	pthread_mutex_t lock;
+	pthread_cond_t flushed;  // signalled whenever flushedLSN moves
+	char *buffer;  // records appended since the last flush started
+	size_t bufUsed;
+	size_t bufSize;
+	char *flushBuf;  // records being written by the current flush leader
+	size_t flushBufSize;
+	LSN bufStartLSN;  // LSN where buffer starts
+	LSN nextLSN;  // end of the log
+	LSN flushedLSN;  // records up to here are durable
+	bool flushing;  // a committer is writing and syncing on behalf of the others
+	bool failed;  // a flush failed: what it held may be lost, so nothing is appended or flushed after it
+	int groupCommitDelay;  // microseconds a flush leader waits for more committers
+	int numFlushes;  // fsyncs issued
+	int numCommits;
+} WAL_Log;
+
+// Entry of the dirty page table carried by a WAL_CHECKPOINT_BEGIN record
+typedef struct WAL_DirtyPage {
+	int fileId;  // page file of the page within its buffer pool
+	int pageNum;
+	LSN recLSN;  // first record that dirtied the page since it was last written
+} WAL_DirtyPage;
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+extern RC openLog (char *fileName, WAL_Log **log);
+extern RC closeLog (WAL_Log *log);
+extern void setGroupCommitDelay (WAL_Log *log, int micros);
+
+/* appending and forcing records */
+extern RC appendLogRecord (WAL_Log *log, WAL_RecordType type, int pageNum, int offset, int length, const char *data, LSN *lsn);
+extern RC flushLog (WAL_Log *log, LSN lsn);
+extern RC commitLog (WAL_Log *log, LSN *lsn);
+extern LSN getLogEnd (WAL_Log *log);
+
+/* recovery */
+extern RC findCheckpointRedoLSN (char *logFileName, LSN *redoLSN);
+extern RC replayLog (char *logFileName, char *pageFileName, LSN fromLSN, int *numApplied);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif